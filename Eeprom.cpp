@@ -0,0 +1,39 @@
+//
+#include "Eeprom.h"
+#include <avr/interrupt.h>
+
+//the block the interrupt is writing, sPos is its next byte
+static const uint8_t* sData;
+static uint16_t sAddr;
+static uint8_t sLen;
+static uint8_t sPos;
+
+bool eepromWrite(uint16_t addr, const uint8_t* data, uint8_t len) {
+	if (eepromBusy()) return false;
+	sData = data;
+	sAddr = addr;
+	sLen = len;
+	sPos = 0;
+	EECR |= _BV(EERIE);
+	return true;
+}
+
+bool eepromBusy() {
+	return EECR & _BV(EERIE);
+}
+
+//fires whenever the EEPROM is ready for the next write while enabled
+ISR(EE_READY_vect) {
+	while (sPos < sLen) {
+		uint8_t b = sData[sPos];
+		EEAR = sAddr + sPos++;
+		EECR |= _BV(EERE);
+		if (EEDR != b) {
+			EEDR = b;
+			EECR |= _BV(EEMPE);
+			EECR |= _BV(EEPE);
+			return;
+		}
+	}
+	EECR &= ~_BV(EERIE);
+}
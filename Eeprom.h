@@ -0,0 +1,20 @@
+//
+// Background EEPROM writes, shared by the game snapshots and the statistics.
+//
+// Writing an EEPROM byte takes 3.3ms, so eepromWrite() only starts the write
+// and the EE_READY interrupt does it a byte at a time, reading each byte
+// first and skipping the ones that already hold the right value. Only one
+// block is written at a time, eepromBusy() is true until it is done.
+//
+#ifndef _EEPROM_H_
+#define _EEPROM_H_
+
+#include "Arduino.h"
+
+//start writing len bytes to addr, false (and nothing written) while
+//eepromBusy(). data is read as the write goes, so it must not change until
+//eepromBusy() is false again
+bool eepromWrite(uint16_t addr, const uint8_t* data, uint8_t len);
+bool eepromBusy();
+
+#endif
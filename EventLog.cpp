@@ -0,0 +1,112 @@
+//
+#include "EventLog.h"
+
+#ifdef SD_LOG
+#include "Storage.h"
+
+static bool sReady; //the card is in the middle of the multi-block write
+static uint32_t sFirstBlock, sNextBlock, sEndBlock;
+
+//the block being filled is Storage's sector buffer, the images at boot are
+//done with it by the time logBegin() runs
+static LogRecord* const sRecords = (LogRecord*)storageBuffer;
+static uint8_t sUsed;            //records in the block, with the header
+static uint8_t sLost;            //records dropped while the block was full
+static unsigned long sFilledAt;  //millis() of the first record after the header
+
+static void startBlock() {
+	memset(storageBuffer, 0, sizeof(storageBuffer));
+	LogRecord& r = sRecords[0];
+	r.Type = LogBlock;
+	r.Arg = sLost;
+	r.Value = sNextBlock - sFirstBlock;
+	r.At = micros();
+	sUsed = 1;
+	sLost = 0;
+}
+
+//the name of log file n
+static void logName(char* name, uint8_t n) {
+	strcpy(name, LOG_FILE);
+	name[LOG_FILE_DIGIT] = '0' + n;
+}
+
+static bool logExists(const char* name) {
+	SdFile file;
+	if (!file.open(&storageRoot, name, O_READ))
+		return false;
+	file.close();
+	return true;
+}
+
+bool logBegin(uint8_t csPin) {
+	StorageBus bus;
+	SdFile file;
+	uint32_t first, last;
+	if (!storageBegin(csPin))
+		return false;
+	//a fresh file every boot, so its blocks are contiguous, in the first
+	//free name. The one after it goes, to keep the gap that marks the newest
+	char name[sizeof(LOG_FILE)];
+	uint8_t n = 0;
+	logName(name, n);
+	while (n < LOG_FILES - 1 && logExists(name))
+		logName(name, ++n);
+	char next[sizeof(LOG_FILE)];
+	logName(next, (n + 1) % LOG_FILES);
+	SdFile::remove(&storageRoot, next);
+	SdFile::remove(&storageRoot, name);
+	if (!file.createContiguous(&storageRoot, name, LOG_BLOCKS*512) ||
+		!file.contiguousRange(&first, &last))
+		return false;
+	file.close();
+	//the card pre-erases the whole range for the write
+	if (!storageCard.writeStart(first, LOG_BLOCKS))
+		return false;
+	sFirstBlock = first;
+	sNextBlock = first;
+	sEndBlock = last + 1;
+	sLost = 0;
+	startBlock();
+	sReady = true;
+	return true;
+}
+
+void logRecord(uint8_t type, uint8_t arg, uint16_t value, uint32_t at) {
+	if (!sReady) return;
+	if (sUsed == LOG_RECORDS) {
+		if (sLost != 0xFF) ++sLost;
+		return;
+	}
+	if (sUsed == 1)
+		sFilledAt = millis();
+	LogRecord& r = sRecords[sUsed++];
+	r.Type = type;
+	r.Arg = arg;
+	r.Value = value;
+	r.At = at;
+}
+
+void logInput(const InputEvent& e) {
+	logRecord(LogInput, e.Type, ((uint8_t)e.DX << 8) | (uint8_t)e.DY, e.At);
+}
+
+void logService() {
+	if (!sReady || sUsed == 1) return;
+	if (sUsed < LOG_RECORDS && millis() - sFilledAt < LOG_FLUSH_MS) return;
+	StorageBus bus;
+	if (storageBusy()) return;
+	if (!storageCard.writeData(storageBuffer)) {
+		sReady = false;
+		return;
+	}
+	if (++sNextBlock == sEndBlock) {
+		//the file is full, the log stops there
+		storageCard.writeStop();
+		sReady = false;
+		return;
+	}
+	startBlock();
+}
+
+#endif
@@ -0,0 +1,80 @@
+//
+// Input and game state log on the SD card, compiled in with SD_LOG.
+//
+// Every input event, the number of every deal, and the board's state hash
+// after every action go as 8 byte records into a 512 byte block in SRAM,
+// Storage's sector buffer. Whole blocks are written straight to the sectors
+// of a file allocated contiguously at boot, as one long multi-block write, so
+// there is no filesystem work and no per-byte File::write() while the game
+// runs.
+//
+// LOG_SERVICE() does the writing and is only called between frames. It
+// sends at most one block, and never waits on the card: if it is still
+// programming the last block it tries again on the next call. A block that
+// has been partly filled for LOG_FLUSH_MS goes out padded, so a power cut
+// loses little. Records that come in while the block is full and waiting
+// are counted in the header of the next one.
+//
+// Every boot writes a new file, and the logs of the boots before it are
+// kept, the one of a session that crashed most of all. The files go round
+// LOG_FILES names, EVENTS0.LOG to EVENTS3.LOG, with one name always missing:
+// a boot takes the first missing name and removes the one after it, so the
+// newest log is the one just before the gap and the LOG_FILES-2 before that
+// are still on the card. Numbered files need no rename, which the SD
+// library doesn't have, and the card never holds more than
+// (LOG_FILES-1)*LOG_BLOCKS of logs.
+//
+// The card is brought up, and shared with the display, by Storage.
+//
+// tools/eventlog.py decodes the file.
+//
+#ifndef _EVENTLOG_H_
+#define _EVENTLOG_H_
+
+#include "Arduino.h"
+#include "Input.h"
+
+#define LOG_FILE      "EVENTS0.LOG" //LOG_FILE_DIGIT is the file's number
+#define LOG_FILE_DIGIT 6
+#define LOG_FILES     4
+#define LOG_BLOCKS    4096UL //2MB, preallocated
+#define LOG_FLUSH_MS  2000   //longest a record waits in SRAM between frames
+#define LOG_RECORDS   (512/sizeof(LogRecord))
+
+enum LogRecordType {
+	LogPadding = 0,
+	LogInput   = 1,    //Arg is the InputEventType, Value is DX << 8 | DY
+	LogDeal    = 2,    //Value is the deal number
+	LogState   = 3,    //Value is BoardState::stateHash() after an action
+	LogBlock   = 0xB1, //first in every block, Value is the block's number
+	                   //in the file, Arg the records lost before it
+};
+
+struct LogRecord {
+	uint8_t Type;
+	uint8_t Arg;
+	uint16_t Value;
+	uint32_t At; //micros()
+};
+
+#ifdef SD_LOG
+//find the card and allocate the file, false (and logging off) if either fails
+bool logBegin(uint8_t csPin);
+void logRecord(uint8_t type, uint8_t arg, uint16_t value, uint32_t at);
+void logInput(const InputEvent& e);
+void logService();
+
+#define LOG_BEGIN(csPin)  logBegin(csPin)
+#define LOG_INPUT(e)      logInput(e)
+#define LOG_DEAL(deal)    logRecord(LogDeal, 0, (deal), micros())
+#define LOG_STATE(hash)   logRecord(LogState, 0, (hash), micros())
+#define LOG_SERVICE()     logService()
+#else
+#define LOG_BEGIN(csPin)
+#define LOG_INPUT(e)
+#define LOG_DEAL(deal)
+#define LOG_STATE(hash)
+#define LOG_SERVICE()
+#endif
+
+#endif
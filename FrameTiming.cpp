@@ -0,0 +1,39 @@
+//
+#include "FrameTiming.h"
+#include "Telemetry.h"
+
+#ifdef FRAME_TIMING
+
+static FrameTimingReport sReport;
+static uint8_t sStage;
+static unsigned long sStageStartedAt;
+
+//charge the time since the last switch to the current stage
+static void frameTimingCharge(unsigned long now) {
+	unsigned long ticks = sReport.Ticks[sStage] + ((now - sStageStartedAt) >> 2);
+	sReport.Ticks[sStage] = (ticks > 0xFFFF) ? 0xFFFF : ticks;
+	sStageStartedAt = now;
+}
+
+void frameTimingBegin() {
+	memset(sReport.Ticks, 0, sizeof(sReport.Ticks));
+	sReport.DirtyArea = 0;
+	sStage = StageInput;
+	sStageStartedAt = micros();
+}
+
+void frameTimingStage(uint8_t stage) {
+	frameTimingCharge(micros());
+	sStage = stage;
+}
+
+void frameTimingEnd(uint16_t dirtyArea) {
+	frameTimingCharge(micros());
+	sReport.DirtyArea = dirtyArea;
+	telemetrySend(TelemetryFrameTiming, &sReport, sizeof(sReport));
+	sReport.Frame++;
+	//anything else in the same pass of the loop starts a fresh frame
+	frameTimingBegin();
+}
+
+#endif
@@ -0,0 +1,54 @@
+//
+// Per-stage frame timing, compiled in with FRAME_TIMING.
+//
+// The main loop opens a frame with FRAME_BEGIN() every time it samples the
+// input while nothing is being painted, and FRAME_STAGE() switches the stage
+// the time is charged to. A frame is painted in slices between input polls,
+// so a stage can be charged several times before the frame is closed with
+// FRAME_END(). Then the time spent in each stage and the size of the region
+// that was redrawn go out as a TelemetryFrameTiming frame. Frames where
+// nothing happened are dropped.
+//
+// Without FRAME_TIMING all of the macros expand to nothing.
+//
+#ifndef _FRAMETIMING_H_
+#define _FRAMETIMING_H_
+
+#include "Arduino.h"
+
+enum FrameStage {
+	StageInput,       //sampling the joystick and buttons
+	StageAction,      //moveCursor() / button1Down()
+	StageBackground,  //felt fill of the dirty region
+	StageDeck,        //stock
+	StageWaste,       //revealed cards
+	StageFoundations, //the four stacks
+	StageTableau,     //the seven columns
+	StageHeld,        //cards hovering the cursor
+	StageCursor,      //cursor-only repaint
+	StageHud,         //status line cells
+	StageCount,
+};
+
+//payload of a TelemetryFrameTiming frame
+struct FrameTimingReport {
+	uint16_t Frame;             //sequence number, to spot dropped frames
+	uint16_t DirtyArea;         //pixels in the region that was redrawn
+	uint16_t Ticks[StageCount]; //4us ticks (the resolution of micros())
+};
+
+#ifdef FRAME_TIMING
+void frameTimingBegin();
+void frameTimingStage(uint8_t stage);
+void frameTimingEnd(uint16_t dirtyArea);
+
+#define FRAME_BEGIN()    frameTimingBegin()
+#define FRAME_STAGE(s)   frameTimingStage(s)
+#define FRAME_END(area)  frameTimingEnd(area)
+#else
+#define FRAME_BEGIN()
+#define FRAME_STAGE(s)
+#define FRAME_END(area)
+#endif
+
+#endif
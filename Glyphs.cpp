@@ -0,0 +1,95 @@
+//
+#include "Glyphs.h"
+#include "Mod_Adafruit_ST7735.h"
+#include <avr/pgmspace.h>
+
+extern Adafruit_ST7735 tft;
+
+//the characters we have glyphs for, and their columns in the same order
+static const char sGlyphChars[] PROGMEM = "\x03\x04\x05\x06" "0123456789AJQK :MST" "BDEFILNOPRVWY%-";
+static const uint8_t sGlyphs[][5] PROGMEM = {
+	{0x1C, 0x3E, 0x7C, 0x3E, 0x1C}, //0x03 heart
+	{0x18, 0x3C, 0x7E, 0x3C, 0x18}, //0x04 diamond
+	{0x1C, 0x57, 0x7D, 0x57, 0x1C}, //0x05 club
+	{0x1C, 0x5E, 0x7F, 0x5E, 0x1C}, //0x06 spade
+	{0x3E, 0x51, 0x49, 0x45, 0x3E}, //0
+	{0x00, 0x42, 0x7F, 0x40, 0x00}, //1
+	{0x72, 0x49, 0x49, 0x49, 0x46}, //2
+	{0x21, 0x41, 0x49, 0x4D, 0x33}, //3
+	{0x18, 0x14, 0x12, 0x7F, 0x10}, //4
+	{0x27, 0x45, 0x45, 0x45, 0x39}, //5
+	{0x3C, 0x4A, 0x49, 0x49, 0x31}, //6
+	{0x41, 0x21, 0x11, 0x09, 0x07}, //7
+	{0x36, 0x49, 0x49, 0x49, 0x36}, //8
+	{0x46, 0x49, 0x49, 0x29, 0x1E}, //9
+	{0x7C, 0x12, 0x11, 0x12, 0x7C}, //A
+	{0x20, 0x40, 0x41, 0x3F, 0x01}, //J
+	{0x3E, 0x41, 0x51, 0x21, 0x5E}, //Q
+	{0x7F, 0x08, 0x14, 0x22, 0x41}, //K
+	{0x00, 0x00, 0x00, 0x00, 0x00}, //space
+	{0x00, 0x36, 0x36, 0x00, 0x00}, //:
+	{0x7F, 0x02, 0x0C, 0x02, 0x7F}, //M
+	{0x46, 0x49, 0x49, 0x49, 0x31}, //S
+	{0x01, 0x01, 0x7F, 0x01, 0x01}, //T
+	{0x7F, 0x49, 0x49, 0x49, 0x36}, //B
+	{0x7F, 0x41, 0x41, 0x41, 0x3E}, //D
+	{0x7F, 0x49, 0x49, 0x49, 0x41}, //E
+	{0x7F, 0x09, 0x09, 0x09, 0x01}, //F
+	{0x00, 0x41, 0x7F, 0x41, 0x00}, //I
+	{0x7F, 0x40, 0x40, 0x40, 0x40}, //L
+	{0x7F, 0x04, 0x08, 0x10, 0x7F}, //N
+	{0x3E, 0x41, 0x41, 0x41, 0x3E}, //O
+	{0x7F, 0x09, 0x09, 0x09, 0x06}, //P
+	{0x7F, 0x09, 0x19, 0x29, 0x46}, //R
+	{0x1F, 0x20, 0x40, 0x20, 0x1F}, //V
+	{0x3F, 0x40, 0x38, 0x40, 0x3F}, //W
+	{0x07, 0x08, 0x70, 0x08, 0x07}, //Y
+	{0x23, 0x13, 0x08, 0x64, 0x62}, //%
+	{0x08, 0x08, 0x08, 0x08, 0x08}, //-
+};
+
+static int8_t glyphIndex(char c) {
+	for (uint8_t i = 0; i < sizeof(sGlyphChars) - 1; ++i)
+		if (pgm_read_byte(&sGlyphChars[i]) == c)
+			return i;
+	return -1;
+}
+
+uint8_t glyphColumn(char c, uint8_t col) {
+	int8_t i = glyphIndex(c);
+	if (i < 0 || col >= 5)
+		return 0;
+	return pgm_read_byte(&sGlyphs[i][col]);
+}
+
+char* putNumber(char* c, uint16_t n, uint8_t width) {
+	uint16_t most = 9;
+	for (uint8_t i = 1; i < width; ++i)
+		most = most*10 + 9;
+	if (n > most)
+		n = most;
+	for (int8_t i = width-1; i >= 0; --i) {
+		c[i] = (n || i == width-1) ? '0' + n%10 : ' ';
+		n /= 10;
+	}
+	return c + width;
+}
+
+void drawGlyph(int x, int y, char c, uint16_t color, uint16_t bg) {
+	//the part of the cell that is on screen
+	int c0 = max(0, -x), c1 = min(GLYPH_W, tft.width() - x);
+	int r0 = max(0, -y), r1 = min(GLYPH_H, tft.height() - y);
+	if (c0 >= c1 || r0 >= r1)
+		return;
+	uint8_t columns[GLYPH_W];
+	int8_t i = glyphIndex(c);
+	for (uint8_t col = 0; col < GLYPH_W; ++col)
+		columns[col] = (i < 0 || col >= 5) ? 0 : pgm_read_byte(&sGlyphs[i][col]);
+	//
+	tft.setAddrWindow(x + c0, y + r0, x + c1 - 1, y + r1 - 1);
+	tft.fastPushColorBegin();
+	for (int row = r0; row < r1; ++row)
+		for (int col = c0; col < c1; ++col)
+			tft.fastPushColor((columns[col] & (1 << row)) ? color : bg);
+	tft.fastPushColorEnd();
+}
@@ -0,0 +1,30 @@
+//
+// The handful of 5x7 glyphs the board, the HUD and the stats screen draw, from
+// the classic GFX font.
+//
+// A glyph is drawn as a 6x8 cell (a blank column on the right and a blank
+// row at the bottom, like Adafruit_GFX::drawChar() with a background) that
+// is streamed into a single address window, rather than going out a pixel
+// at a time. glyphColumn() gives the bits of a cell for code that has to
+// know what a glyph left on screen.
+//
+#ifndef _GLYPHS_H_
+#define _GLYPHS_H_
+
+#include "Arduino.h"
+
+#define GLYPH_W 6
+#define GLYPH_H 8
+
+//column col (0 to GLYPH_W-1) of the glyph for c, bit n set where row n is
+//lit, blank for characters that have no glyph
+uint8_t glyphColumn(char c, uint8_t col);
+
+//write n right aligned into width cells, clamped to what fits, and return
+//the cell after them
+char* putNumber(char* c, uint16_t n, uint8_t width);
+
+//draw the cell for c at (x, y), clipped to the screen
+void drawGlyph(int x, int y, char c, uint16_t color, uint16_t bg);
+
+#endif
@@ -0,0 +1,48 @@
+//
+#include "Hud.h"
+
+Hud::Hud() {
+	memset(mLine, 0, HUD_PANEL);
+	memset(mLine + HUD_PANEL, ' ', HUD_STATUS);
+	invalidateAll();
+}
+
+void Hud::update(uint16_t moves, uint16_t seconds, uint16_t score) {
+	//"M  12 T 3:07 S 140"
+	char* c = mLine + HUD_PANEL;
+	*c++ = 'M';
+	c = putNumber(c, moves, 4);
+	*c++ = ' ';
+	*c++ = 'T';
+	c = putNumber(c, min(seconds/60, 99), 2);
+	*c++ = ':';
+	*c++ = '0' + (seconds%60)/10;
+	*c++ = '0' + seconds%10;
+	*c++ = ' ';
+	*c++ = 'S';
+	c = putNumber(c, score, 4);
+}
+
+void Hud::setPanel(const char* cells) {
+	memcpy(mLine, cells, HUD_PANEL);
+}
+
+void Hud::invalidate(int x, int y, int w, int h) {
+	if (w <= 0 || h <= 0 || y + h <= HUD_Y || y >= HUD_Y + GLYPH_H)
+		return;
+	for (uint8_t i = 0; i < HUD_CELLS; ++i) {
+		int cellX = HUD_X + i*GLYPH_W;
+		if (x < cellX + GLYPH_W && x + w > cellX)
+			mShown[i] = 0;
+	}
+}
+
+void Hud::invalidateAll() {
+	memset(mShown, 0, sizeof(mShown));
+}
+
+uint8_t Hud::nextChanged(uint8_t i) const {
+	while (i < HUD_CELLS && mShown[i] == mLine[i])
+		++i;
+	return i;
+}
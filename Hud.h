@@ -0,0 +1,53 @@
+//
+// Status line with the move count, the time since the deal and the score.
+//
+// The HUD is a row of glyph cells along the bottom right of the screen, over
+// the bottom of the tableau. It remembers which character each cell is
+// showing and nextChanged() gives the cells whose character changed, which
+// the board draws with only the lit pixels of the glyph over its cards and
+// felt, so a ticking clock costs one or two cells a second and no card is
+// ever hidden behind the line. Whatever the board paints over a cell has to
+// be passed to invalidate() so that the cell gets drawn again.
+//
+// The row carries on to the left of the status line with HUD_PANEL cells
+// that setPanel() fills, for the race mode's view of the other board. Cells
+// holding 0 or a space show only the board.
+//
+#ifndef _HUD_H_
+#define _HUD_H_
+
+#include "Arduino.h"
+#include "Glyphs.h"
+
+#define HUD_STATUS 18 //the status line at the right end of the row,
+#define HUD_PANEL  8  //and the panel before it
+#define HUD_CELLS  (HUD_PANEL + HUD_STATUS)
+#define HUD_X      (160 - HUD_CELLS*GLYPH_W)
+#define HUD_Y      (128 - GLYPH_H)
+
+class Hud {
+public:
+	Hud();
+
+	//format the values into the cells, doesn't draw anything
+	void update(uint16_t moves, uint16_t seconds, uint16_t score);
+	//the HUD_PANEL cells of the panel, also only formatted
+	void setPanel(const char* cells);
+
+	//the cells overlapping this screen rect need painting again
+	void invalidate(int x, int y, int w, int h);
+	void invalidateAll();
+
+	//the first cell from i on whose character changed since it was last
+	//drawn, HUD_CELLS if there is none
+	uint8_t nextChanged(uint8_t i) const;
+	//what cell i should show, and that it is now showing it
+	char cell(uint8_t i) const { return mLine[i]; }
+	void drawn(uint8_t i) { mShown[i] = mLine[i]; }
+
+private:
+	char mLine[HUD_CELLS];  //what the cells should show
+	char mShown[HUD_CELLS]; //what they show, 0 if unknown
+};
+
+#endif
@@ -0,0 +1,70 @@
+//
+#include "Idle.h"
+#include "Input.h"
+#include "Telemetry.h"
+#include "Mod_Adafruit_ST7735.h"
+#include <avr/sleep.h>
+
+extern Adafruit_ST7735 tft;
+
+enum PanelState {
+	PanelOn,
+	PanelDimmed,
+	PanelAsleep,
+};
+
+static uint8_t sPanel = PanelOn;
+static unsigned long sLastActivityAt;
+
+void idleActivity() {
+	sLastActivityAt = millis();
+	if (sPanel == PanelAsleep)
+		tft.sleepDisplay(false);
+	if (sPanel != PanelOn)
+		tft.idleMode(false);
+	sPanel = PanelOn;
+}
+
+//a byte came in that the main loop reads, for the telemetry requests, the
+//remote or the race
+static bool serialPending() {
+#ifdef RACE
+	if (Serial1.available())
+		return true;
+#endif
+#if defined(TELEMETRY_REQUESTS) || defined(REMOTE)
+	if (Serial.available())
+		return true;
+#endif
+	return false;
+}
+
+void idleWait(unsigned long wakeAt) {
+	unsigned long idleFor = millis() - sLastActivityAt;
+	if (sPanel == PanelOn && idleFor > IDLE_DIM_MS) {
+		tft.idleMode(true);
+		sPanel = PanelDimmed;
+	}
+#ifdef IDLE_PANEL_SLEEP
+	if (sPanel == PanelDimmed && idleFor > IDLE_SLEEP_MS) {
+		tft.sleepDisplay(true);
+		sPanel = PanelAsleep;
+	}
+#endif
+
+	//only sleep if no input came in since the loop last looked, the
+	//instruction after sei() always runs, so an interrupt between the check
+	//and sleep_cpu() still wakes us. Any other interrupt just goes back to
+	//sleep here rather than through a whole pass of the main loop
+	set_sleep_mode(SLEEP_MODE_IDLE);
+	while (true) {
+		cli();
+		if (inputPending() || serialPending() || (long)(micros() - wakeAt) >= 0)
+			break;
+		sleep_enable();
+		sei();
+		sleep_cpu();
+		sleep_disable();
+	}
+	sei();
+}
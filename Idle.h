@@ -0,0 +1,39 @@
+//
+// Power saving while nobody is playing.
+//
+// Whenever the main loop has nothing to do, idleWait() puts the MCU in idle
+// sleep. The input interrupts keep running in idle sleep, so input still
+// lands in the queue and wakes the loop right away. The free-running ADC
+// interrupts ~9600 times a second though, so idleWait() goes back to sleep
+// after every interrupt that didn't queue input or bring in a byte on a
+// serial port, until the time the loop asks to be woken at. That is the next
+// stick repeat, or IDLE_POLL_MS on for the deadlines the loop only polls
+// (the HUD clock, the log flush, the race progress, a busy card).
+//
+// After IDLE_DIM_MS without input the panel is dropped into 8 colour idle
+// mode, and with IDLE_PANEL_SLEEP it is put to sleep altogether after
+// IDLE_SLEEP_MS. The panel keeps its frame memory in both, so idleActivity()
+// (called for every input) only has to switch it back, the board doesn't
+// need to be redrawn.
+//
+#ifndef _IDLE_H_
+#define _IDLE_H_
+
+#include "Arduino.h"
+
+#ifndef IDLE_DIM_MS
+#define IDLE_DIM_MS   30000UL
+#endif
+#ifndef IDLE_SLEEP_MS
+#define IDLE_SLEEP_MS 120000UL
+#endif
+#define IDLE_POLL_MS  20 //longest the main loop sleeps without input
+
+//someone is playing, wake the panel if it was idle
+void idleActivity();
+
+//sleep until there is input or serial data, or micros() reaches wakeAt,
+//dimming the panel if it is time to
+void idleWait(unsigned long wakeAt);
+
+#endif
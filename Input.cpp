@@ -0,0 +1,259 @@
+//
+#include "Input.h"
+#include <avr/interrupt.h>
+
+#define INPUT_QUEUE_MASK (INPUT_QUEUE_SIZE - 1)
+
+//samples of pin 9 (one per conversion, ~104us apart) that have to agree
+//before the button changes state
+#define SELECT_DEBOUNCE_SAMPLES 40
+//edges of pin 14 closer than this to the last accepted one are bounce
+#define RESET_DEBOUNCE_US 20000UL
+//each axis is sampled ~1600 times a second. Its rest position only follows
+//the readings once they have stayed within half the dead zone for ~500ms,
+//and then with a time constant of 2^DRIFT_SHIFT samples (~0.6s), so even a
+//slow push outruns it and is never taken for drift
+#define DRIFT_SETTLE_SAMPLES 800
+#define DRIFT_SHIFT 10
+
+///////////////////////////////////////////////////////////////////////////////
+// event queue
+
+static InputEvent sQueue[INPUT_QUEUE_SIZE];
+static volatile uint8_t sHead; //written by the main loop only
+static volatile uint8_t sTail; //written by the interrupts only
+static volatile uint8_t sOverflows;
+
+//called from interrupt context only
+static void inputPush(uint8_t type, int8_t dx, int8_t dy) {
+	uint8_t tail = sTail;
+	uint8_t next = (tail + 1) & INPUT_QUEUE_MASK;
+	if (next == sHead) {
+		if (sOverflows != 0xFF) ++sOverflows;
+		return;
+	}
+	InputEvent& e = sQueue[tail];
+	e.Type = type;
+	e.DX = dx;
+	e.DY = dy;
+	e.At = micros();
+	sTail = next;
+}
+
+void inputInject(uint8_t type, int8_t dx, int8_t dy) {
+	//the interrupts are the only producer, so be one of them for a moment
+	uint8_t oldSREG = SREG;
+	cli();
+	inputPush(type, dx, dy);
+	SREG = oldSREG;
+}
+
+bool inputPoll(InputEvent& event) {
+	uint8_t head = sHead;
+	if (head == sTail)
+		return false;
+	event = sQueue[head];
+	sHead = (head + 1) & INPUT_QUEUE_MASK;
+	return true;
+}
+
+bool inputPending() {
+	return sHead != sTail;
+}
+
+uint8_t inputOverflows() {
+	return sOverflows;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// sampling
+
+static const uint8_t sChannels[] = {
+	INPUT_JOY_Y_CHANNEL, INPUT_JOY_X_CHANNEL, INPUT_NOISE_CHANNEL
+};
+static uint8_t sChannelIndex;
+static bool sSkipConversion;
+
+//rest position of each axis in 1/2^DRIFT_SHIFT counts, samples it has been
+//settled for, and the latest deflection
+static long sJoyBase[2];
+static uint16_t sJoySettled[2];
+static volatile int sJoyDeflection[2];
+static int8_t sJoyDX, sJoyDY;
+
+static volatile uint8_t* sSelectPort;
+static uint8_t sSelectMask;
+static uint8_t sSelectCount;
+static bool sSelectDown;
+
+static volatile uint8_t* sResetPort;
+static uint8_t sResetMask;
+static bool sResetDown;
+static unsigned long sResetEdgeAt;
+
+static volatile uint16_t sEntropy;
+
+static int8_t quantize(int delta) {
+	if (delta > INPUT_DEAD_ZONE) return 1;
+	if (delta < -INPUT_DEAD_ZONE) return -1;
+	return 0;
+}
+
+ISR(ADC_vect) {
+	uint16_t value = ADC;
+
+	//in free-running mode the next conversion has already started when this
+	//one completes, so a mux change only applies to the one after it. Every
+	//other result is thrown away to keep the channels apart.
+	if (sSkipConversion) {
+		sSkipConversion = false;
+	} else {
+		uint8_t channel = sChannels[sChannelIndex];
+		sEntropy = (sEntropy << 1 | sEntropy >> 15) ^ value;
+		if (channel == INPUT_JOY_Y_CHANNEL || channel == INPUT_JOY_X_CHANNEL) {
+			uint8_t axis = (channel == INPUT_JOY_X_CHANNEL);
+			int delta = (int)value - (int)(sJoyBase[axis] >> DRIFT_SHIFT);
+			if (abs(delta) > INPUT_DEAD_ZONE/2) {
+				//a deflection has started, leave the rest position alone
+				sJoySettled[axis] = 0;
+			} else if (sJoySettled[axis] < DRIFT_SETTLE_SAMPLES) {
+				++sJoySettled[axis];
+			} else {
+				//settled at rest, track the drift (a slow moving average)
+				sJoyBase[axis] += delta;
+			}
+			//up on the stick reads high, but moves the cursor up
+			if (!axis) delta = -delta;
+			sJoyDeflection[axis] = delta;
+			int8_t dy = sJoyDY, dx = sJoyDX;
+			if (axis)
+				dx = quantize(delta);
+			else
+				dy = quantize(delta);
+			if (dx != sJoyDX || dy != sJoyDY) {
+				sJoyDX = dx;
+				sJoyDY = dy;
+				inputPush(InputJoystick, dx, dy);
+			}
+		}
+		if (++sChannelIndex == sizeof(sChannels))
+			sChannelIndex = 0;
+		ADMUX = _BV(REFS0) | sChannels[sChannelIndex];
+		sSkipConversion = true;
+	}
+
+	//debounce the select button, it reads low when pressed
+	if (!(*sSelectPort & sSelectMask)) {
+		if (sSelectCount < SELECT_DEBOUNCE_SAMPLES && ++sSelectCount == SELECT_DEBOUNCE_SAMPLES && !sSelectDown) {
+			sSelectDown = true;
+			inputPush(InputSelectDown, 0, 0);
+		}
+	} else {
+		if (sSelectCount > 0 && --sSelectCount == 0 && sSelectDown) {
+			sSelectDown = false;
+			inputPush(InputSelectUp, 0, 0);
+		}
+	}
+}
+
+//pin 14 is PCINT10, in the PCINT1 group
+ISR(PCINT1_vect) {
+	bool down = !(*sResetPort & sResetMask);
+	if (down == sResetDown)
+		return;
+	unsigned long now = micros();
+	if (now - sResetEdgeAt < RESET_DEBOUNCE_US)
+		return;
+	sResetEdgeAt = now;
+	sResetDown = down;
+	if (down)
+		inputPush(InputResetDown, 0, 0);
+}
+
+void inputBegin() {
+	pinMode(INPUT_SELECT_PIN, INPUT_PULLUP);
+	pinMode(INPUT_RESET_PIN, INPUT_PULLUP);
+	sSelectPort = portInputRegister(digitalPinToPort(INPUT_SELECT_PIN));
+	sSelectMask = digitalPinToBitMask(INPUT_SELECT_PIN);
+	sResetPort = portInputRegister(digitalPinToPort(INPUT_RESET_PIN));
+	sResetMask = digitalPinToBitMask(INPUT_RESET_PIN);
+	sResetDown = !(*sResetPort & sResetMask);
+
+	//the stick should be at rest now
+	sJoyBase[0] = (long)analogRead(INPUT_JOY_Y_CHANNEL) << DRIFT_SHIFT;
+	sJoyBase[1] = (long)analogRead(INPUT_JOY_X_CHANNEL) << DRIFT_SHIFT;
+
+	//pin change interrupt for the reset button
+	*digitalPinToPCMSK(INPUT_RESET_PIN) |= _BV(digitalPinToPCMSKbit(INPUT_RESET_PIN));
+	PCICR |= _BV(digitalPinToPCICRbit(INPUT_RESET_PIN));
+
+	//free-running ADC, /128 prescaler => 125kHz ADC clock, 9.6k conversions/s
+	sChannelIndex = 0;
+	sSkipConversion = false;
+	ADMUX = _BV(REFS0) | sChannels[0];
+	ADCSRB = 0;
+	ADCSRA = _BV(ADEN) | _BV(ADSC) | _BV(ADATE) | _BV(ADIE) |
+	         _BV(ADPS2) | _BV(ADPS1) | _BV(ADPS0);
+}
+
+uint16_t inputEntropy() {
+	uint8_t oldSREG = SREG;
+	cli();
+	uint16_t e = sEntropy;
+	SREG = oldSREG;
+	return e;
+}
+
+int inputDeflection() {
+	uint8_t oldSREG = SREG;
+	cli();
+	int y = sJoyDeflection[0], x = sJoyDeflection[1];
+	SREG = oldSREG;
+	return max(abs(x), abs(y));
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// JoystickRepeat
+
+JoystickRepeat::JoystickRepeat(): mDX(0), mDY(0), mIntervalMs(0), mNextAt(0) {
+	Config.InitialDelayMs = 300;
+	Config.StartIntervalMs = 180;
+	Config.MinIntervalMs = 50;
+	Config.AccelPercent = 20;
+}
+
+bool JoystickRepeat::onEvent(const InputEvent& e) {
+	bool fromRest = (mDX == 0 && mDY == 0);
+	mDX = e.DX;
+	mDY = e.DY;
+	if ((mDX == 0 && mDY == 0) || !fromRest)
+		return false;
+	//a fresh push, move now and start the repeat over
+	mIntervalMs = Config.StartIntervalMs;
+	mNextAt = e.At + Config.InitialDelayMs*1000UL;
+	return true;
+}
+
+bool JoystickRepeat::poll(unsigned long now, unsigned long& dueAt) {
+	if (mDX == 0 && mDY == 0)
+		return false;
+	if ((long)(now - mNextAt) < 0)
+		return false;
+	dueAt = mNextAt;
+	//slow the interval down for a stick that is only pushed a little
+	int d = constrain(inputDeflection(), INPUT_DEAD_ZONE, INPUT_FULL_SCALE);
+	unsigned long interval = mIntervalMs +
+		(unsigned long)mIntervalMs * (INPUT_FULL_SCALE - d) / (INPUT_FULL_SCALE - INPUT_DEAD_ZONE);
+	mNextAt = now + interval*1000UL;
+	//and speed up the next one
+	uint16_t faster = mIntervalMs - (uint32_t)mIntervalMs * Config.AccelPercent / 100;
+	mIntervalMs = max(faster, Config.MinIntervalMs);
+	return true;
+}
+
+void JoystickRepeat::nextDue(unsigned long& wakeAt) const {
+	if ((mDX != 0 || mDY != 0) && (long)(mNextAt - wakeAt) < 0)
+		wakeAt = mNextAt;
+}
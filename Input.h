@@ -0,0 +1,109 @@
+//
+// Interrupt driven joystick and button input.
+//
+// The ADC free-runs over the two joystick axes and the floating channel 7
+// (for entropy), with the conversion-complete interrupt turning stick
+// positions into events as the stick crosses the dead zone. Once the stick
+// has been left at rest for half a second its rest position slowly follows
+// the readings, so the calibration taken at boot doesn't go stale as the
+// stick drifts, while even a slow push gets out of the dead zone.
+//
+// The select button on pin 9 has no pin-change interrupt on the mega2560
+// (PH6), so it is debounced from the same interrupt, sampled on every
+// conversion. The new game button on pin 14 (PJ1) uses its pin-change
+// interrupt.
+//
+// Events land in a single-producer/single-consumer ring read by the main loop
+// with inputPoll(). The interrupts are the producer (AVR interrupts don't
+// nest, so they never race each other) and only ever write the tail, the
+// main loop only writes the head, and both indices are single bytes, so no
+// locking is needed on either side.
+//
+#ifndef _INPUT_H_
+#define _INPUT_H_
+
+#include "Arduino.h"
+
+#define INPUT_JOY_Y_CHANNEL 0
+#define INPUT_JOY_X_CHANNEL 1
+#define INPUT_NOISE_CHANNEL 7
+#define INPUT_SELECT_PIN    9
+#define INPUT_RESET_PIN     14
+
+#define INPUT_DEAD_ZONE     35  //ADC counts around the rest position
+#define INPUT_FULL_SCALE    400 //deflection treated as pushed all the way
+#define INPUT_QUEUE_SIZE    16  //power of two
+
+enum InputEventType {
+	InputJoystick,   //the stick direction changed, DX/DY are -1, 0 or 1
+	InputSelectDown, //pin 9 pressed
+	InputSelectUp,   //pin 9 released
+	InputResetDown,  //pin 14 pressed
+};
+
+struct InputEvent {
+	uint8_t Type;
+	int8_t DX;       //right is positive
+	int8_t DY;       //down is positive
+	unsigned long At; //micros() when the interrupt saw it
+};
+
+//calibrate the stick (which should be at rest) and start the interrupts
+void inputBegin();
+
+//queue an event from outside the interrupts (the remote control), as if
+//they had seen it just now
+void inputInject(uint8_t type, int8_t dx, int8_t dy);
+
+//take the oldest pending event, false if there are none
+bool inputPoll(InputEvent& event);
+
+//are there events waiting for inputPoll()
+bool inputPending();
+
+//events lost because the queue was full
+uint8_t inputOverflows();
+
+//bits stirred from the ADC noise, for seeding rand()
+uint16_t inputEntropy();
+
+//how far the stick is pushed along its furthest axis, in ADC counts
+int inputDeflection();
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Turns joystick events into cursor moves. A deflection from rest moves once
+// right away, then after InitialDelayMs the move repeats, every repeat coming
+// AccelPercent sooner than the last down to MinIntervalMs. The intervals are
+// for a stick pushed all the way, a stick only just outside the dead zone
+// repeats at half that speed.
+struct RepeatConfig {
+	uint16_t InitialDelayMs;
+	uint16_t StartIntervalMs;
+	uint16_t MinIntervalMs;
+	uint8_t AccelPercent;
+};
+
+class JoystickRepeat {
+public:
+	JoystickRepeat();
+
+	//feed every InputJoystick event through here, true if it should move now
+	bool onEvent(const InputEvent& e);
+	//true if a repeat is due at now, dueAt is when it became due
+	bool poll(unsigned long now, unsigned long& dueAt);
+	//bring wakeAt forward to the next repeat, if the stick is held
+	void nextDue(unsigned long& wakeAt) const;
+
+	int8_t dx() const {return mDX; }
+	int8_t dy() const {return mDY; }
+
+	RepeatConfig Config;
+
+private:
+	int8_t mDX, mDY;
+	uint16_t mIntervalMs;
+	unsigned long mNextAt;
+};
+
+#endif
@@ -0,0 +1,34 @@
+//
+#include "Latency.h"
+#include "Telemetry.h"
+
+#ifdef LATENCY_STATS
+
+static LatencyReport sReport = {LATENCY_BUDGET_US};
+
+//index of the half-octave bucket holding a latency
+static uint8_t latencyBucket(unsigned long us) {
+	if (us < (1UL << LATENCY_MIN_SHIFT))
+		return 0;
+	uint8_t msb = 31;
+	while (!(us & (1UL << msb)))
+		--msb;
+	uint8_t half = (us >> (msb-1)) & 1;
+	uint8_t index = 1 + (msb - LATENCY_MIN_SHIFT)*2 + half;
+	return min(index, LATENCY_BUCKETS-1);
+}
+
+void latencyRecord(unsigned long eventAt) {
+	unsigned long us = micros() - eventAt;
+	uint16_t& bucket = sReport.Buckets[latencyBucket(us)];
+	if (bucket != 0xFFFF) ++bucket;
+	if (sReport.Count != 0xFFFF) ++sReport.Count;
+	if (us > LATENCY_BUDGET_US && sReport.OverBudget != 0xFFFF) ++sReport.OverBudget;
+	if (us > sReport.WorstUs) sReport.WorstUs = us;
+}
+
+void latencyDump() {
+	telemetrySend(TelemetryLatency, &sReport, sizeof(sReport));
+}
+
+#endif
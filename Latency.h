@@ -0,0 +1,45 @@
+//
+// Input to display latency histogram, compiled in with LATENCY_STATS.
+//
+// For every input event the main loop passes the micros() timestamp of the
+// event (the joystick leaving the dead zone, or the button edge) to
+// LATENCY_RECORD() once the draw() for it has returned, at which point the
+// last byte has left the SPI bus. Latencies go into half-octave buckets from
+// 256us up, so the whole histogram is a few dozen bytes of SRAM.
+//
+// Sending LATENCY_DUMP_REQUEST over Serial makes TELEMETRY_POLL() answer with a
+// TelemetryLatency frame (tools/telemetry.py -l asks for and prints one).
+// Events slower than LATENCY_BUDGET_US are counted separately.
+//
+#ifndef _LATENCY_H_
+#define _LATENCY_H_
+
+#include "Arduino.h"
+
+#ifndef LATENCY_BUDGET_US
+#define LATENCY_BUDGET_US 100000UL
+#endif
+
+#define LATENCY_MIN_SHIFT    8   //bucket 0 is below 2^8 us, 1 starts there
+#define LATENCY_BUCKETS      32  //two per octave from 1, the last from ~8s
+#define LATENCY_DUMP_REQUEST 'L'
+
+//payload of a TelemetryLatency frame
+struct LatencyReport {
+	uint32_t BudgetUs;
+	uint16_t Count;
+	uint16_t OverBudget;
+	uint32_t WorstUs;
+	uint16_t Buckets[LATENCY_BUCKETS];
+};
+
+#ifdef LATENCY_STATS
+void latencyRecord(unsigned long eventAt);
+void latencyDump();
+
+#define LATENCY_RECORD(eventAt) latencyRecord(eventAt)
+#else
+#define LATENCY_RECORD(eventAt)
+#endif
+
+#endif
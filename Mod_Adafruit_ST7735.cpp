@@ -23,6 +23,13 @@
 #include "wiring_private.h"
 #include <SPI.h>
 
+// bookkeeping for the SPI_STATS counters, compiles to nothing otherwise
+#ifdef SPI_STATS
+ #define SPI_STAT(x) (x)
+#else
+ #define SPI_STAT(x)
+#endif
+
 
 // Constructor when using software SPI.  All output pins are configurable.
 Adafruit_ST7735::Adafruit_ST7735(uint8_t cs, uint8_t rs, uint8_t sid,
@@ -33,6 +40,8 @@ Adafruit_ST7735::Adafruit_ST7735(uint8_t cs, uint8_t rs, uint8_t sid,
   _sclk = sclk;
   _rst  = rst;
   hwSPI = false;
+  _warm = false;
+  _slpoutAt = 0;
 }
 
 
@@ -44,12 +53,15 @@ Adafruit_ST7735::Adafruit_ST7735(uint8_t cs, uint8_t rs, uint8_t rst) {
   _rst  = rst;
   hwSPI = true;
   _sid  = _sclk = 0;
+  _warm = false;
+  _slpoutAt = 0;
 }
 
 
 inline void Adafruit_ST7735::spiwrite(uint8_t c) {
 
   //Serial.println(c, HEX);
+  SPI_STAT((*rsport & rspinmask) ? stats.dataBytes++ : stats.commandBytes++);
 
   if (hwSPI) {
     SPDR = c;
@@ -69,6 +81,7 @@ inline void Adafruit_ST7735::spiwrite(uint8_t c) {
 void Adafruit_ST7735::writecommand(uint8_t c) {
   *rsport &= ~rspinmask;
   *csport &= ~cspinmask;
+  SPI_STAT(stats.csToggles++);
 
   //Serial.print("C ");
   spiwrite(c);
@@ -80,6 +93,7 @@ void Adafruit_ST7735::writecommand(uint8_t c) {
 void Adafruit_ST7735::writedata(uint8_t c) {
   *rsport |=  rspinmask;
   *csport &= ~cspinmask;
+  SPI_STAT(stats.csToggles++);
     
   //Serial.print("D ");
   spiwrite(c);
@@ -226,19 +240,43 @@ PROGMEM static prog_uchar
       100 };                  //     100 ms delay
 
 
+#ifdef FAST_BOOT
+// With FAST_BOOT the table delays are replaced by the datasheet minimums:
+// 120 ms after SWRESET before SLPOUT, 5 ms after SLPOUT before the next
+// command, nothing for the rest. SWRESET is dropped when the hardware reset
+// already did it (or the panel was left initialized by a warm reset), and
+// DISPON is held back for displayOn().
+static uint16_t fastBootDelay(uint8_t cmd) {
+  switch(cmd) {
+  case ST7735_SWRESET: return 120;
+  case ST7735_SLPOUT:  return 5;
+  default:             return 0;
+  }
+}
+#endif
+
+
 // Companion code to the above tables.  Reads and issues
 // a series of LCD commands stored in PROGMEM byte array.
 void Adafruit_ST7735::commandList(uint8_t *addr) {
 
-  uint8_t  numCommands, numArgs;
+  uint8_t  numCommands, numArgs, cmd;
   uint16_t ms;
 
   numCommands = pgm_read_byte(addr++);   // Number of commands to follow
   while(numCommands--) {                 // For each command...
-    writecommand(pgm_read_byte(addr++)); //   Read, issue command
+    cmd      = pgm_read_byte(addr++);    //   Read command
     numArgs  = pgm_read_byte(addr++);    //   Number of args to follow
     ms       = numArgs & DELAY;          //   If hibit set, delay follows args
     numArgs &= ~DELAY;                   //   Mask out delay bit
+#ifdef FAST_BOOT
+    if((cmd == ST7735_SWRESET && (_rst || _warm)) || cmd == ST7735_DISPON) {
+      addr += numArgs + (ms ? 1 : 0);    //   Skip it, args and delay
+      continue;
+    }
+#endif
+    writecommand(cmd);                   //   Issue command
+    if(cmd == ST7735_SLPOUT) _slpoutAt = millis();
     while(numArgs--) {                   //   For each argument...
       writedata(pgm_read_byte(addr++));  //     Read, issue argument
     }
@@ -246,6 +284,9 @@ void Adafruit_ST7735::commandList(uint8_t *addr) {
     if(ms) {
       ms = pgm_read_byte(addr++); // Read post-command delay time (ms)
       if(ms == 255) ms = 500;     // If 255, delay for 500 ms
+#ifdef FAST_BOOT
+      ms = fastBootDelay(cmd);
+#endif
       delay(ms);
     }
   }
@@ -257,6 +298,9 @@ void Adafruit_ST7735::commonInit(uint8_t *cmdList) {
 
   constructor(ST7735_TFTWIDTH, ST7735_TFTHEIGHT);
   colstart  = rowstart = 0; // May be overridden in init func
+#ifdef SPI_STATS
+  memset(&stats, 0, sizeof(stats));
+#endif
 
   pinMode(_rs, OUTPUT);
   pinMode(_cs, OUTPUT);
@@ -267,7 +311,8 @@ void Adafruit_ST7735::commonInit(uint8_t *cmdList) {
 
   if(hwSPI) { // Using hardware SPI
     SPI.begin();
-    SPI.setClockDivider(SPI_CLOCK_DIV4); // 4 MHz (half speed)
+    SPI.setClockDivider(SPI_CLOCK_DIV4); // 4 MHz (half speed), keep in sync
+                                         // with ST7735_SPI_DIVIDER
     SPI.setBitOrder(MSBFIRST);
     SPI.setDataMode(SPI_MODE0);
   } else {
@@ -286,14 +331,29 @@ void Adafruit_ST7735::commonInit(uint8_t *cmdList) {
   if (_rst) {
     pinMode(_rst, OUTPUT);
     digitalWrite(_rst, HIGH);
+#ifdef FAST_BOOT
+    // a panel that kept power through a warm reset is already initialized,
+    // otherwise 10 us low resets it, and it takes 120 ms to come out
+    if (!_warm) {
+      digitalWrite(_rst, LOW);
+      delayMicroseconds(10);
+      digitalWrite(_rst, HIGH);
+      delay(120);
+    }
+#else
     delay(500);
     digitalWrite(_rst, LOW);
     delay(500);
     digitalWrite(_rst, HIGH);
     delay(500);
+#endif
   }
 
   if(cmdList) commandList(cmdList);
+#ifdef FAST_BOOT
+  // the panel may have been left dimmed by idleMode() before the reset
+  if (_warm) writecommand(ST7735_IDMOFF);
+#endif
 }
 
 
@@ -345,6 +405,7 @@ void Adafruit_ST7735::fillScreen(uint16_t color) {
 
   *rsport |=  rspinmask;
   *csport &= ~cspinmask;
+  SPI_STAT(stats.csToggles++);
 
   for(y=_height; y>0; y--) {
     for(x=_width; x>0; x--) {
@@ -359,6 +420,7 @@ void Adafruit_ST7735::fillScreen(uint16_t color) {
 void Adafruit_ST7735::fastPushColorBegin() {
   *rsport |=  rspinmask;
   *csport &= ~cspinmask;
+  SPI_STAT(stats.csToggles++);
 }
 
 void Adafruit_ST7735::fastPushColor(uint16_t color) {
@@ -370,9 +432,30 @@ void Adafruit_ST7735::fastPushColorEnd() {
   *csport |= cspinmask;
 }
 
+// Raw bytes as the panel takes them in the current colour mode (big-endian
+// RGB565, or 4-4-4 with two pixels to three bytes in 12 bit mode), between
+// fastPushColorBegin() and fastPushColorEnd(). The next byte is fetched
+// while the last one is still shifting out.
+void Adafruit_ST7735::fastPushBytes(const uint8_t *data, uint16_t n) {
+  if (!hwSPI) {
+    while (n--) spiwrite(*data++);
+    return;
+  }
+  if (!n) return;
+  SPI_STAT(stats.dataBytes += n);
+  SPDR = *data++;
+  while (--n) {
+    uint8_t c = *data++;
+    while(!(SPSR & _BV(SPIF)));
+    SPDR = c;
+  }
+  while(!(SPSR & _BV(SPIF)));
+}
+
 void Adafruit_ST7735::pushColor(uint16_t color) {
   *rsport |=  rspinmask;
   *csport &= ~cspinmask;
+  SPI_STAT(stats.csToggles++);
 
   spiwrite(color >> 8);
   spiwrite(color);
@@ -389,6 +472,7 @@ void Adafruit_ST7735::drawPixel(int16_t x, int16_t y, uint16_t color) {
 
   *rsport |=  rspinmask;
   *csport &= ~cspinmask;
+  SPI_STAT(stats.csToggles++);
 
   spiwrite(color >> 8);
   spiwrite(color);
@@ -408,6 +492,7 @@ void Adafruit_ST7735::drawFastVLine(int16_t x, int16_t y, int16_t h,
   uint8_t hi = color >> 8, lo = color;
   *rsport |=  rspinmask;
   *csport &= ~cspinmask;
+  SPI_STAT(stats.csToggles++);
   while (h--) {
     spiwrite(hi);
     spiwrite(lo);
@@ -427,6 +512,7 @@ void Adafruit_ST7735::drawFastHLine(int16_t x, int16_t y, int16_t w,
   uint8_t hi = color >> 8, lo = color;
   *rsport |=  rspinmask;
   *csport &= ~cspinmask;
+  SPI_STAT(stats.csToggles++);
   while (w--) {
     spiwrite(hi);
     spiwrite(lo);
@@ -449,6 +535,7 @@ void Adafruit_ST7735::fillRect(int16_t x, int16_t y, int16_t w, int16_t h,
   uint8_t hi = color >> 8, lo = color;
   *rsport |=  rspinmask;
   *csport &= ~cspinmask;
+  SPI_STAT(stats.csToggles++);
   for(y=h; y>0; y--) {
     for(x=w; x>0; x--) {
       spiwrite(hi);
@@ -507,6 +594,49 @@ void Adafruit_ST7735::invertDisplay(boolean i) {
 }
 
 
+// Turn the display on. Under FAST_BOOT the init lists leave this out so the
+// first frame can be drawn while the panel is still blank, and this waits
+// out whatever is left of the 120 ms the panel needs after SLPOUT first.
+void Adafruit_ST7735::displayOn(void) {
+  unsigned long since = millis() - _slpoutAt;
+  if (since < 120) delay(120 - since);
+  writecommand(ST7735_DISPON);
+}
+
+
+// Warm tells commonInit() that the panel stayed powered and initialized
+// through the reset, so (under FAST_BOOT) the reset can be skipped.
+void Adafruit_ST7735::setWarmStart(boolean warm) {
+  _warm = warm;
+}
+
+
+// 12 bit colour takes a quarter fewer bytes per pixel than the usual 16,
+// for images that are stored that way. Set it before setAddrWindow(), as any
+// command ends the memory write.
+void Adafruit_ST7735::setColorDepth(uint8_t bits) {
+  writecommand(ST7735_COLMOD);
+  writedata(bits == 12 ? 0x03 : 0x05);
+}
+
+
+// Idle mode drops the panel to 8 colours (the MSB of each channel), which
+// cuts its power draw a lot while keeping the picture up.
+void Adafruit_ST7735::idleMode(boolean i) {
+  writecommand(i ? ST7735_IDMON : ST7735_IDMOFF);
+}
+
+
+// Sleep turns the panel off, but the frame memory is kept, so it comes back
+// showing what it did before. The panel needs 5 ms after either command for
+// its supplies to settle, and 120 ms between a SLPOUT and the next SLPIN.
+void Adafruit_ST7735::sleepDisplay(boolean s) {
+  writecommand(s ? ST7735_SLPIN : ST7735_SLPOUT);
+  if (!s) _slpoutAt = millis();
+  delay(5);
+}
+
+
 ////////// stuff not actively being used, but kept for posterity
 /*
 
@@ -35,6 +35,10 @@
 #define ST7735_TFTWIDTH  128
 #define ST7735_TFTHEIGHT 160
 
+// SPI clock divider used with hardware SPI (see commonInit()), every byte
+// keeps the bus busy for 8*ST7735_SPI_DIVIDER cpu cycles
+#define ST7735_SPI_DIVIDER 4
+
 #define ST7735_NOP     0x00
 #define ST7735_SWRESET 0x01
 #define ST7735_RDDID   0x04
@@ -55,6 +59,8 @@
 #define ST7735_RAMRD   0x2E
 
 #define ST7735_PTLAR   0x30
+#define ST7735_IDMOFF  0x38
+#define ST7735_IDMON   0x39
 #define ST7735_COLMOD  0x3A
 #define ST7735_MADCTL  0x36
 
@@ -92,6 +98,30 @@
 #define ST7735_WHITE   0xFFFF
 
 
+#ifdef SPI_STATS
+// Running totals of the traffic sent to the display. Only compiled in with
+// SPI_STATS, take a copy before and after some drawing to see what it cost.
+struct ST7735Stats {
+  uint32_t commandBytes, // bytes sent with D/C low
+           dataBytes,    // bytes sent with D/C high
+           csToggles;    // number of times CS was asserted
+
+  uint32_t bytes() const { return commandBytes + dataBytes; }
+  // time the bus is busy for these bytes at the configured divider
+  uint32_t estimateMicros() const {
+    return bytes() * 8 * ST7735_SPI_DIVIDER / (F_CPU / 1000000L);
+  }
+  ST7735Stats operator-(const ST7735Stats& o) const {
+    ST7735Stats d;
+    d.commandBytes = commandBytes - o.commandBytes;
+    d.dataBytes    = dataBytes    - o.dataBytes;
+    d.csToggles    = csToggles    - o.csToggles;
+    return d;
+  }
+};
+#endif
+
+
 class Adafruit_ST7735 : public Adafruit_GFX {
 
  public:
@@ -106,6 +136,7 @@ class Adafruit_ST7735 : public Adafruit_GFX {
            fastPushColorBegin(),
            fastPushColor(uint16_t color),
            fastPushColorEnd(),
+           fastPushBytes(const uint8_t *data, uint16_t n),
            pushColor(uint16_t color),
            fillScreen(uint16_t color),
            drawPixel(int16_t x, int16_t y, uint16_t color),
@@ -114,9 +145,18 @@ class Adafruit_ST7735 : public Adafruit_GFX {
            fillRect(int16_t x, int16_t y, int16_t w, int16_t h,
              uint16_t color),
            setRotation(uint8_t r),
-           invertDisplay(boolean i);
+           invertDisplay(boolean i),
+           idleMode(boolean i),
+           sleepDisplay(boolean s),
+           displayOn(void),
+           setWarmStart(boolean warm),
+           setColorDepth(uint8_t bits);
   uint16_t Color565(uint8_t r, uint8_t g, uint8_t b);
 
+#ifdef SPI_STATS
+  ST7735Stats stats;
+#endif
+
   /* These are not for current use, 8-bit protocol only!
   uint8_t  readdata(void),
            readcommand8(uint8_t);
@@ -134,7 +174,8 @@ class Adafruit_ST7735 : public Adafruit_GFX {
            commonInit(uint8_t *cmdList);
 //uint8_t  spiread(void);
 
-  boolean  hwSPI;
+  boolean  hwSPI, _warm;
+  unsigned long _slpoutAt; // millis() of the last SLPOUT
   volatile uint8_t *dataport, *clkport, *csport, *rsport;
   uint8_t  _cs, _rs, _rst, _sid, _sclk,
            datapinmask, clkpinmask, cspinmask, rspinmask,
@@ -0,0 +1,124 @@
+//
+#include "Profile.h"
+#include "Telemetry.h"
+#include <avr/interrupt.h>
+#include <avr/pgmspace.h>
+
+#ifdef PROFILE
+
+//prescaler 32, so the compare value fits Timer2's 8 bits
+#define PROFILE_TOP    (F_CPU / 32 / PROFILE_HZ - 1)
+#define PROFILE_JITTER 16
+
+//from the linker script: the end of the PROGMEM tables and constructors,
+//where the code starts, and the end of the code
+extern "C" char __ctors_end, _etext;
+
+static uint16_t sBins[PROFILE_BINS];
+static uint32_t sBase;
+static uint32_t sSamples;
+static uint16_t sOutside;
+static uint8_t sShift;
+static uint8_t sHalved;
+static uint8_t sJitter;
+
+//the word address that was interrupted, low byte first, put there by the
+//vector before it goes on to profileSample
+static volatile uint8_t sPc[3];
+
+static void halve() {
+	for (uint16_t i = 0; i < PROFILE_BINS; ++i)
+		sBins[i] >>= 1;
+	sOutside >>= 1;
+	if (sHalved != 0xFF) ++sHalved;
+}
+
+//the rest of the interrupt, with the usual prologue and reti. Named like a
+//vector so avr-gcc takes the signal attribute on it
+extern "C" void __vector_profile_sample() __attribute__((signal, used));
+void __vector_profile_sample() {
+	uint32_t at = ((uint32_t)sPc[2] << 16 | (uint16_t)sPc[1] << 8 | sPc[0]) << 1;
+	++sSamples;
+	if (at < sBase || ((at - sBase) >> sShift) >= PROFILE_BINS) {
+		if (++sOutside == 0xFFFF) halve();
+	} else {
+		if (++sBins[(at - sBase) >> sShift] == 0xFFFF) halve();
+	}
+	sJitter = sJitter*5 + 1;
+	OCR2A = PROFILE_TOP - PROFILE_JITTER/2 + sJitter % PROFILE_JITTER;
+}
+
+//the compiler's prologue pushes however many registers the body needs, so
+//the return address is read here before anything but three known pushes.
+//The ATmega2560 pushes a 3 byte PC, high byte at the lowest address. None of
+//these instructions touch SREG
+ISR(TIMER2_COMPA_vect, ISR_NAKED) {
+	asm volatile(
+		"push r24\n\t"
+		"push r30\n\t"
+		"push r31\n\t"
+		"in r30, __SP_L__\n\t"
+		"in r31, __SP_H__\n\t"
+		"ldd r24, Z+6\n\t"
+		"sts %0, r24\n\t"
+		"ldd r24, Z+5\n\t"
+		"sts %0+1, r24\n\t"
+		"ldd r24, Z+4\n\t"
+		"sts %0+2, r24\n\t"
+		"pop r31\n\t"
+		"pop r30\n\t"
+		"pop r24\n\t"
+		"jmp __vector_profile_sample\n\t"
+		:: "i" (sPc));
+}
+
+void profileBegin() {
+#ifdef pgm_get_far_address
+	sBase = pgm_get_far_address(__ctors_end);
+	uint32_t end = pgm_get_far_address(_etext);
+#else
+	sBase = (uint16_t)&__ctors_end;
+	uint32_t end = (uint16_t)&_etext;
+#endif
+	sShift = 1;
+	while (((end - sBase) >> sShift) >= PROFILE_BINS)
+		++sShift;
+	profileReset();
+
+	//CTC on OCR2A
+	TCCR2A = _BV(WGM21);
+	TCCR2B = _BV(CS21) | _BV(CS20);
+	OCR2A = PROFILE_TOP;
+	TCNT2 = 0;
+	TIMSK2 = _BV(OCIE2A);
+}
+
+void profileReset() {
+	uint8_t oldSREG = SREG;
+	cli();
+	memset(sBins, 0, sizeof(sBins));
+	sSamples = 0;
+	sOutside = 0;
+	sHalved = 0;
+	SREG = oldSREG;
+}
+
+void profileDump() {
+	ProfileReport r;
+	for (uint16_t first = 0; first < PROFILE_BINS; first += PROFILE_CHUNK) {
+		//a consistent chunk, the sampling goes on while it is sent
+		uint8_t oldSREG = SREG;
+		cli();
+		r.Base = sBase;
+		r.Samples = sSamples;
+		r.Outside = sOutside;
+		r.First = first;
+		r.Shift = sShift;
+		r.Halved = sHalved;
+		memcpy(r.Bins, sBins + first, sizeof(r.Bins));
+		SREG = oldSREG;
+		telemetrySend(TelemetryProfile, &r, sizeof(r));
+	}
+}
+
+#endif
@@ -0,0 +1,52 @@
+//
+// Sampling profiler, compiled in with PROFILE.
+//
+// Timer2 interrupts about PROFILE_HZ times a second, and the program counter
+// it interrupted is read off the stack and counted in one of PROFILE_BINS
+// bins. The bins cover the code from the end of the PROGMEM tables to the end
+// of .text, 2^Shift bytes each with the shift picked at boot, so a build of
+// ~40KB gets bins of 256 bytes. The period is jittered a little so loops that
+// run in step with another timer aren't always caught at the same point.
+//
+// Sending PROFILE_RESET_REQUEST over Serial clears the bins, and
+// PROFILE_DUMP_REQUEST answers with them in TelemetryProfile frames of
+// PROFILE_CHUNK bins each. tools/fwprofile.py asks for them and splits the
+// bins between the functions in the ELF's symbol table.
+//
+// Samples can't land inside another interrupt handler or with interrupts
+// off, that time goes to the instruction after the sei() or reti. The timer
+// also wakes the board inside idleWait(), which goes straight back to sleep,
+// so idle time shows up there. Pins 9 and 10 lose analogWrite(), which the
+// game doesn't use.
+//
+#ifndef _PROFILE_H_
+#define _PROFILE_H_
+
+#include "Arduino.h"
+
+#ifndef PROFILE_BINS
+#define PROFILE_BINS 256
+#endif
+#define PROFILE_HZ            4000
+#define PROFILE_CHUNK         32
+#define PROFILE_DUMP_REQUEST  'P'
+#define PROFILE_RESET_REQUEST 'p'
+
+//payload of a TelemetryProfile frame
+struct ProfileReport {
+	uint32_t Base;      //byte address of the start of bin 0
+	uint32_t Samples;   //taken since the last reset
+	uint16_t Outside;   //samples that were before Base or past the last bin
+	uint16_t First;     //the bin Bins starts at
+	uint8_t Shift;      //bins are 2^Shift bytes
+	uint8_t Halved;     //times every count was halved so none overflowed
+	uint16_t Bins[PROFILE_CHUNK];
+};
+
+#ifdef PROFILE
+void profileBegin();
+void profileReset();
+void profileDump();
+#endif
+
+#endif
@@ -0,0 +1,139 @@
+//
+#include "Race.h"
+#include "Telemetry.h"
+#include "Glyphs.h"
+#include <util/crc16.h>
+
+#ifdef RACE
+
+//the frame being received: type, length, payload and crc
+static uint8_t sFrame[3 + RACE_MAX_PAYLOAD];
+static int8_t sGot = -1; //bytes of it so far, -1 while looking for the sync
+
+static RaceProgressReport sSent, sTheirs;
+static unsigned long sSentAt, sHeardAt, sStartedAt;
+static bool sHeard;
+static uint16_t sStartDeal, sDeal;
+
+void raceBegin() {
+	Serial1.begin(RACE_BAUD);
+}
+
+void raceStart(uint16_t deal) {
+	RaceStartCommand c;
+	c.Deal = deal;
+	telemetrySend(Serial1, RaceStart, &c, sizeof(c));
+	sStartDeal = deal;
+	sStartedAt = millis();
+}
+
+//act on a frame with a good crc, true if the other board started a new game
+static bool raceDispatch(uint8_t type, const uint8_t* payload, uint8_t len, uint16_t& deal) {
+	switch (type) {
+	case RaceStart: {
+		if (len != sizeof(RaceStartCommand)) break;
+		uint16_t theirs = ((const RaceStartCommand*)payload)->Deal;
+		//both pressed reset at once, the higher deal is played and ours
+		//makes the other board come round to it
+		if (millis() - sStartedAt < RACE_SETTLE_MS && theirs <= sStartDeal)
+			break;
+		deal = theirs;
+		return true;
+	}
+	case RaceProgress:
+		if (len != sizeof(RaceProgressReport)) break;
+		memcpy(&sTheirs, payload, sizeof(sTheirs));
+		sHeardAt = millis();
+		sHeard = true;
+		break;
+	}
+	return false;
+}
+
+bool raceService(const RaceProgressReport& mine, uint16_t& deal) {
+	unsigned long now = millis();
+	sDeal = mine.Deal;
+	bool changed = memcmp(&mine, &sSent, sizeof(mine)) != 0;
+	if ((changed && now - sSentAt >= RACE_SEND_MS) || now - sSentAt >= RACE_KEEPALIVE_MS) {
+		telemetrySend(Serial1, RaceProgress, &mine, sizeof(mine));
+		sSent = mine;
+		sSentAt = now;
+	}
+
+	bool started = false;
+	while (Serial1.available()) {
+		uint8_t b = Serial1.read();
+		if (sGot < 0) {
+			if (b == TELEMETRY_SYNC)
+				sGot = 0;
+			continue;
+		}
+		sFrame[sGot++] = b;
+		if (sGot == 2 && sFrame[1] > RACE_MAX_PAYLOAD) {
+			sGot = -1;
+			continue;
+		}
+		if (sGot < 3 || sGot < 3 + sFrame[1])
+			continue;
+		//a bad frame is dropped, progress comes again and a lost start only
+		//leaves the boards on different deals until the next one
+		uint8_t len = sFrame[1], crc = 0;
+		for (uint8_t i = 0; i < 2 + len; ++i)
+			crc = _crc_ibutton_update(crc, sFrame[i]);
+		if (crc == sFrame[2 + len])
+			started |= raceDispatch(sFrame[0], sFrame + 2, len, deal);
+		sGot = -1;
+	}
+	return started;
+}
+
+//the number on top of a foundation as a single cell
+static char rankCell(uint8_t n) {
+	static const char ranks[] = "-A234567890JQK";
+	return n < sizeof(ranks) - 1 ? ranks[n] : '-';
+}
+
+void racePanel(char* c) {
+	//blank cells aren't drawn, the board shows through until there is a race
+	if (!sHeard) {
+		memset(c, 0, HUD_PANEL);
+		return;
+	}
+	memset(c, ' ', HUD_PANEL);
+	unsigned long now = millis();
+	if (now - sHeardAt >= RACE_LOST_MS || sTheirs.Deal != sDeal) {
+		//"VS ----"
+		c[0] = 'V';
+		c[1] = 'S';
+		memset(c + 3, '-', 4);
+		return;
+	}
+	switch ((now / RACE_PAGE_MS) % 3) {
+	case 0:
+		//"VS A35KW"
+		c[0] = 'V';
+		c[1] = 'S';
+		for (uint8_t i = 0; i < 4; ++i)
+			c[3 + i] = rankCell((sTheirs.Foundations >> 4*i) & 0xF);
+		if (sTheirs.Won)
+			c[7] = 'W';
+		break;
+	case 1:
+		//"M  123"
+		c[0] = 'M';
+		putNumber(c + 1, sTheirs.Moves, 4);
+		break;
+	case 2: {
+		//"T 3:07"
+		uint16_t s = sTheirs.Seconds;
+		c[0] = 'T';
+		c = putNumber(c + 1, min(s/60, 99), 2);
+		*c++ = ':';
+		*c++ = '0' + (s%60)/10;
+		*c++ = '0' + s%10;
+		break;
+	}
+	}
+}
+
+#endif
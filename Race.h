@@ -0,0 +1,68 @@
+//
+// Head-to-head race against a second board over Serial1, compiled in with RACE.
+//
+// The two boards have their Serial1 pins crossed (TX1 18 to RX1 19 both ways)
+// and their grounds joined. A new game on either one sends a RaceStart frame
+// with its deal number and the other one deals the same number, so both play
+// the same cards. If both send one within RACE_SETTLE_MS, the higher deal
+// number is played on both.
+//
+// While playing, each board sends its progress, the foundation heights, the
+// moves and the time, in a RaceProgress frame whenever it changes, at most
+// every RACE_SEND_MS and at least every RACE_KEEPALIVE_MS. The other board
+// shows it in the HUD_PANEL cells at the left of the HUD, which go through
+// the foundations, the moves and the time every RACE_PAGE_MS. The panel is
+// dashes while the other board is on a different deal or has been silent for
+// RACE_LOST_MS, and isn't drawn at all until it is first heard from.
+//
+// The frames use the Telemetry framing, 6 and 13 bytes at RACE_BAUD, so they
+// always fit Serial1's transmit buffer and sending never waits on the wire.
+// raceService() runs between frames and only reads what has already arrived,
+// so the link never holds up draw() or an input.
+//
+// tools/simbench -1 connects the simulated Serial1 to a tty, so two simbench
+// instances on the two ends of a pty pair race each other, see README.md.
+//
+#ifndef _RACE_H_
+#define _RACE_H_
+
+#include "Arduino.h"
+#include "Hud.h"
+
+#define RACE_BAUD         115200
+#define RACE_SEND_MS      100
+#define RACE_KEEPALIVE_MS 1000
+#define RACE_LOST_MS      3000
+#define RACE_SETTLE_MS    500
+#define RACE_PAGE_MS      2000
+#define RACE_MAX_PAYLOAD  12
+
+//payload of a RaceStart frame
+struct RaceStartCommand {
+	uint16_t Deal;
+};
+
+//payload of a RaceProgress frame
+struct RaceProgressReport {
+	uint16_t Deal;        //frames from before a new deal are told apart by it
+	uint16_t Foundations; //4 bits each, the number on top of each foundation
+	uint16_t Moves;
+	uint16_t Seconds;
+	uint8_t Won;
+};
+
+#ifdef RACE
+void raceBegin();
+
+//this board dealt a new game, the other one should play it too
+void raceStart(uint16_t deal);
+
+//send this board's progress if it is due and read what the other board has
+//sent, true with the deal if it started a new game
+bool raceService(const RaceProgressReport& mine, uint16_t& deal);
+
+//the text of the panel, HUD_PANEL cells
+void racePanel(char* cells);
+#endif
+
+#endif
@@ -0,0 +1,66 @@
+//
+#include "Remote.h"
+#include "Telemetry.h"
+#include "Input.h"
+#include <util/crc16.h>
+
+#ifdef REMOTE
+
+//the frame being received: type, length, payload and crc
+static uint8_t sFrame[3 + REMOTE_MAX_PAYLOAD];
+static int8_t sGot = -1; //bytes of it so far, -1 while looking for the sync
+static uint16_t sSent;
+
+//act on a frame with a good crc, true if it asks for the state
+static bool remoteDispatch(uint8_t type, const uint8_t* payload, uint8_t len) {
+	switch (type) {
+	case RemoteInput: {
+		if (len != sizeof(RemoteInputCommand)) break;
+		const RemoteInputCommand* c = (const RemoteInputCommand*)payload;
+		if (c->Type > InputResetDown || c->DX < -1 || c->DX > 1 || c->DY < -1 || c->DY > 1)
+			break;
+		inputInject(c->Type, c->DX, c->DY);
+		break;
+	}
+	case RemoteStateRequest:
+		return true;
+	}
+	return false;
+}
+
+bool remotePoll() {
+	bool wantState = false;
+	while (Serial.available()) {
+		uint8_t b = Serial.read();
+		if (sGot < 0) {
+			if (b == TELEMETRY_SYNC)
+				sGot = 0;
+			else
+				telemetryRequest(b);
+			continue;
+		}
+		sFrame[sGot++] = b;
+		if (sGot == 2 && sFrame[1] > REMOTE_MAX_PAYLOAD) {
+			//can't be one of ours, look for the next sync
+			sGot = -1;
+			continue;
+		}
+		if (sGot < 3 || sGot < 3 + sFrame[1])
+			continue;
+		//the whole frame is in, a bad one is dropped and the host tries again
+		uint8_t len = sFrame[1], crc = 0;
+		for (uint8_t i = 0; i < 2 + len; ++i)
+			crc = _crc_ibutton_update(crc, sFrame[i]);
+		if (crc == sFrame[2 + len])
+			wantState |= remoteDispatch(sFrame[0], sFrame + 2, len);
+		sGot = -1;
+	}
+	return wantState;
+}
+
+void remoteSend(RemoteStateReport& report) {
+	report.Frame = sSent++;
+	telemetrySend(TelemetryState, &report, sizeof(report));
+}
+
+#endif
@@ -0,0 +1,65 @@
+//
+// Remote control and state mirroring over Serial, compiled in with REMOTE.
+//
+// Both directions use the Telemetry framing at TELEMETRY_BAUD. The host sends
+// RemoteInput frames, which go into the input queue as if the interrupts had
+// seen them, so the game can't tell an injected press from a real one. A
+// joystick push is a RemoteInput with the direction and another with 0, 0
+// when it is let go, just like the stick. RemoteStateRequest asks for a
+// TelemetryState frame right away.
+//
+// The firmware sends a TelemetryState frame after the frame for every input
+// has been painted: the packed board (BoardState::snapshot(), the same bytes
+// that go to the EEPROM), its state hash, and how long the input took to
+// reach the screen. tools/remote.py drives and mirrors the game, and
+// tools/simbench -P stands in for the board on a pty.
+//
+// remotePoll() owns Serial's input in these builds, so a request byte outside
+// a frame (LATENCY_DUMP_REQUEST and the like) is passed on to
+// telemetryRequest() from there. The receive
+// buffer is only 64 bytes, the host should wait for the state frame after an
+// input before sending many more.
+//
+#ifndef _REMOTE_H_
+#define _REMOTE_H_
+
+#include "Arduino.h"
+#include "Save.h"
+
+#define REMOTE_MAX_PAYLOAD 8
+
+//payload of a RemoteInput frame
+struct RemoteInputCommand {
+	uint8_t Type; //InputEventType
+	int8_t DX;
+	int8_t DY;
+};
+
+enum RemoteStateFlags {
+	RemoteSnapshotValid = 0x01, //Snapshot holds the board (not while holding)
+	RemoteHolding       = 0x02,
+	RemoteWon           = 0x04,
+};
+
+//payload of a TelemetryState frame
+struct RemoteStateReport {
+	uint16_t Frame;     //sequence number, to spot dropped frames
+	uint16_t Hash;      //BoardState::stateHash()
+	uint32_t LatencyUs; //oldest input of the frame until it was painted,
+	uint32_t DrawUs;    //and the painting alone. Both 0 when requested
+	uint16_t DrawArea;  //pixels repainted
+	uint8_t Flags;      //RemoteStateFlags
+	uint8_t Held;       //cards being carried,
+	int8_t HeldFirst;   //and the hash of the first (top) one, -1 if none
+	uint8_t Snapshot[SAVE_PAYLOAD];
+};
+
+#ifdef REMOTE
+//read whatever has arrived on Serial and queue the inputs in it, true if the
+//host asked for the state
+bool remotePoll();
+//send a state frame, filling in Frame
+void remoteSend(RemoteStateReport& report);
+#endif
+
+#endif
@@ -0,0 +1,60 @@
+//
+#include "Save.h"
+#include "Eeprom.h"
+#include <avr/eeprom.h>
+#include <util/crc16.h>
+
+static uint8_t sSlot = SAVE_SLOTS - 1; //last slot written
+static uint8_t sSeq;                   //and its sequence number
+
+//the slot being written
+static uint8_t sBuf[SAVE_SLOT_SIZE];
+
+static uint16_t slotCrc(const uint8_t* slot) {
+	uint16_t crc = 0xFFFF;
+	for (uint8_t i = 0; i < SAVE_SLOT_SIZE - 2; ++i)
+		crc = _crc16_update(crc, slot[i]);
+	return crc;
+}
+
+//read slot i, false if it doesn't hold a good snapshot
+static bool readSlot(uint8_t i, uint8_t* slot) {
+	eeprom_read_block(slot, (const void*)(SAVE_EEPROM_BASE + i*SAVE_SLOT_SIZE), SAVE_SLOT_SIZE);
+	uint16_t crc = slot[SAVE_SLOT_SIZE-2] | (slot[SAVE_SLOT_SIZE-1] << 8);
+	return slot[1] == SAVE_VERSION && crc == slotCrc(slot);
+}
+
+bool saveLoad(uint8_t* payload) {
+	//slots are written in turn with the sequence going up by one, so the
+	//newest is the good one not followed by its successor
+	uint8_t slot[SAVE_SLOT_SIZE], next[SAVE_SLOT_SIZE];
+	bool good = readSlot(SAVE_SLOTS-1, next);
+	for (uint8_t i = 0; i < SAVE_SLOTS; ++i) {
+		memcpy(slot, next, SAVE_SLOT_SIZE);
+		bool wasGood = good;
+		good = readSlot(i, next);
+		if (!wasGood || (good && next[0] == (uint8_t)(slot[0] + 1)))
+			continue;
+		sSlot = (i + SAVE_SLOTS - 1) % SAVE_SLOTS;
+		sSeq = slot[0];
+		memcpy(payload, slot + 2, SAVE_PAYLOAD);
+		return true;
+	}
+	return false;
+}
+
+void saveWrite(const uint8_t* payload) {
+	if (eepromBusy()) return;
+	sSlot = (sSlot + 1) % SAVE_SLOTS;
+	sBuf[0] = ++sSeq;
+	sBuf[1] = SAVE_VERSION;
+	memcpy(sBuf + 2, payload, SAVE_PAYLOAD);
+	uint16_t crc = slotCrc(sBuf);
+	sBuf[SAVE_SLOT_SIZE-2] = crc;
+	sBuf[SAVE_SLOT_SIZE-1] = crc >> 8;
+	eepromWrite(SAVE_EEPROM_BASE + sSlot*SAVE_SLOT_SIZE, sBuf, SAVE_SLOT_SIZE);
+}
+
+bool saveBusy() {
+	return eepromBusy();
+}
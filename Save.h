@@ -0,0 +1,68 @@
+//
+// Game snapshots in EEPROM, so a reset or a power cut doesn't lose the game.
+//
+// A snapshot is SAVE_PAYLOAD bytes packed by BoardState::snapshot(). Each
+// one goes into the next of SAVE_SLOTS rotating slots, so the wear is spread
+// over all of them, with a sequence number, a format version and a CRC-16
+// over the lot. At boot saveLoad() picks the newest slot with a good CRC, a
+// slot that was only partly written when the power went fails its CRC and
+// the one before it is used instead.
+//
+// saveWrite() only queues the slot, Eeprom writes it in the background.
+// saveBusy() is true until it is done, or while anything else is being
+// written to the EEPROM.
+//
+#ifndef _SAVE_H_
+#define _SAVE_H_
+
+#include "Arduino.h"
+
+#define SAVE_EEPROM_BASE 0   //the slots sit at the start of the EEPROM
+#define SAVE_SLOTS       64
+#define SAVE_SLOT_SIZE   40  //sequence, version, payload, crc16
+#define SAVE_PAYLOAD     (SAVE_SLOT_SIZE - 4)
+#define SAVE_VERSION     1   //bump when the snapshot or the deal changes
+#define SAVE_EEPROM_END  (SAVE_EEPROM_BASE + SAVE_SLOTS*SAVE_SLOT_SIZE)
+
+//newest good snapshot into payload, false if there is none. Also tells the
+//writer where to carry on from, so call it before the first saveWrite()
+bool saveLoad(uint8_t* payload);
+
+//start writing a snapshot into the next slot, ignored while saveBusy()
+void saveWrite(const uint8_t* payload);
+bool saveBusy();
+
+//packs values of a few bits each into a byte buffer, low bits first
+class BitWriter {
+public:
+	BitWriter(uint8_t* buf, uint8_t size): mBuf(buf), mSize(size), mBit(0) {
+		memset(buf, 0, size);
+	}
+	void put(uint16_t value, uint8_t bits) {
+		for (uint8_t i = 0; i < bits; ++i, ++mBit)
+			if ((value >> i) & 1 && (mBit >> 3) < mSize)
+				mBuf[mBit >> 3] |= 1 << (mBit & 7);
+	}
+	//more was put than fits
+	bool overflowed() const { return mBit > mSize*8; }
+private:
+	uint8_t* mBuf;
+	uint8_t mSize;
+	uint16_t mBit;
+};
+class BitReader {
+public:
+	BitReader(const uint8_t* buf): mBuf(buf), mBit(0) {}
+	uint16_t get(uint8_t bits) {
+		uint16_t value = 0;
+		for (uint8_t i = 0; i < bits; ++i, ++mBit)
+			if (mBuf[mBit >> 3] & (1 << (mBit & 7)))
+				value |= 1 << i;
+		return value;
+	}
+private:
+	const uint8_t* mBuf;
+	uint16_t mBit;
+};
+
+#endif
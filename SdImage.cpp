@@ -0,0 +1,48 @@
+//
+#include "SdImage.h"
+#include "Storage.h"
+#include "Mod_Adafruit_ST7735.h"
+
+#ifdef STORAGE_ENABLED
+
+extern Adafruit_ST7735 tft;
+
+bool sdImageDraw(const char* name, int x, int y, int w, int h) {
+	uint32_t block, size;
+	bool found;
+	{
+		StorageBus bus;
+		found = storageFind(name, block, size);
+	}
+	if (!found)
+		return false;
+	uint32_t pixels = (uint32_t)w * h;
+	bool packed = (size == pixels*3/2);
+	if (!packed && size != pixels*2)
+		return false;
+	//the colour mode is a command, it can't come after the window is open
+	if (packed)
+		tft.setColorDepth(12);
+	tft.setAddrWindow(x, y, x + w - 1, y + h - 1);
+	bool ok = true;
+	while (size) {
+		//the display lets go of the bus between sectors, for the card, and
+		//gets its own SPI rate back for the push
+		{
+			StorageBus bus;
+			ok = storageCard.readBlock(block++, storageBuffer);
+		}
+		if (!ok)
+			break;
+		uint16_t n = min(size, 512UL);
+		tft.fastPushColorBegin();
+		tft.fastPushBytes(storageBuffer, n);
+		tft.fastPushColorEnd();
+		size -= n;
+	}
+	if (packed)
+		tft.setColorDepth(16);
+	return ok;
+}
+
+#endif
@@ -0,0 +1,33 @@
+//
+// Images streamed off the SD card into the display.
+//
+// An image file is just its pixels, row by row, in the form the panel takes
+// them after RAMWR: big-endian RGB565, or 12 bit 4-4-4 with two pixels to
+// three bytes (tools/mkimage.py makes either from a PNG). Which one it is
+// follows from the file size. The 12 bit form is a quarter smaller and a
+// quarter quicker to send, the panel is switched to 12 bit colour while
+// it goes out.
+//
+// Each sector is read into Storage's sector buffer, which the event log only
+// takes over later, and pushed into the address window straight from there,
+// the pixels are never looked at or copied. The card and the display share
+// the bus, so a sector read can't overlap the push of the one before on the
+// wire, but neither costs any per-pixel CPU. A full screen is 80 sectors (60
+// in 12 bit).
+//
+// It needs the card to itself, so images go up before the event log starts
+// its multi-block write.
+//
+#ifndef _SDIMAGE_H_
+#define _SDIMAGE_H_
+
+#include "Arduino.h"
+
+#define SPLASH_FILE "SPLASH.IMG" //shown at boot under SD_SPLASH
+#define SPLASH_MS   1500         //for at least this long
+
+//draw a w x h image file at (x, y), false if it is missing, isn't that
+//size, or isn't contiguous on the card. storageBegin() has to be done
+bool sdImageDraw(const char* name, int x, int y, int w, int h);
+
+#endif
@@ -3,6 +3,22 @@
 //
 #include <Adafruit_GFX.h>      // Core graphics library
 #include "Mod_Adafruit_ST7735.h" // Hardware-specific library
+#include "FrameTiming.h"
+#include "Latency.h"
+#include "Input.h"
+#include "Idle.h"
+#include "Glyphs.h"
+#include "Hud.h"
+#include "Telemetry.h"
+#include "EventLog.h"
+#include "Save.h"
+#include "Storage.h"
+#include "SdImage.h"
+#include "Remote.h"
+#include "Stats.h"
+#include "Race.h"
+#include "Profile.h"
+#include <util/crc16.h>
 
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -22,6 +38,42 @@ int smartmod(int a, int b) {
 
 Adafruit_ST7735 tft = Adafruit_ST7735(TFT_CS, TFT_DC, TFT_RST);
 
+#ifdef FAST_BOOT
+//survives a reset but not a power cycle, set once the panel is initialized so
+//the next boot knows it can skip the panel's reset and its delays
+#define BOOT_MAGIC 0x50A7B007UL
+static uint32_t sBootMagic __attribute__((section(".noinit")));
+
+static bool warmStart() {
+	bool warm = (sBootMagic == BOOT_MAGIC) && !(MCUSR & (_BV(PORF) | _BV(BORF)));
+	MCUSR = 0;
+	sBootMagic = 0;
+	return warm;
+}
+#endif
+
+
+///////////////////////////////////////////////////////////////////////////////
+// benchmark markers
+// Under SIM_BENCH the firmware writes a marker byte to GPIOR0 at the edges of
+// each measured stage, tools/simbench watches that register to know where a
+// stage starts and ends. It costs a single cycle, but is compiled out otherwise.
+// When it replays a recorded session it also picks the deals, through
+// GPIOR2:GPIOR1 (0 leaves them to chance).
+#ifdef SIM_BENCH
+#define BENCH_MARK(m) (GPIOR0 = (m))
+#define BENCH_DEAL(deal) if (GPIOR1 | GPIOR2) (deal) = GPIOR2 << 8 | GPIOR1
+#else
+#define BENCH_MARK(m)
+#define BENCH_DEAL(deal)
+#endif
+enum BenchMarker {
+	BenchBootBegin   = 1, //before initialize()
+	BenchBootEnd     = 2, //after the first draw()
+	BenchActionBegin = 3, //input seen, before the game logic runs
+	BenchActionEnd   = 4, //after the draw() for that input
+};
+
 void error(const char* c) {
 	tft.fillScreen(ST7735_BLUE);
 	tft.setRotation(0);
@@ -126,8 +178,15 @@ struct Rect {
 	void zero() {
 		X = 0; Y = 0; W = 0; H = 0;
 	}
+	void set(int x, int y, int w, int h) {
+		X = x; Y = y; W = w; H = h;
+	}
 	void expand(const Rect& other) {
 		if (other.W == 0 || other.H == 0) return;
+		if (W == 0 || H == 0) {
+			*this = other;
+			return;
+		}
 		int left = max(X+W, other.X+other.W);
 		int bottom = max(Y+H, other.Y+other.H);
 		X = min(X, other.X);
@@ -141,6 +200,53 @@ struct Rect {
 		if (Y > other.Y + other.H || other.Y > Y + H) return false;
 		return true;
 	}
+	//the parts of this rect outside of hole, as up to 4 rects put in out
+	uint8_t subtract(const Rect& hole, Rect* out) const {
+		if (W <= 0 || H <= 0) return 0;
+		int x0 = max(X, hole.X), x1 = min(X+W, hole.X+hole.W);
+		int y0 = max(Y, hole.Y), y1 = min(Y+H, hole.Y+hole.H);
+		if (hole.W <= 0 || hole.H <= 0 || x0 >= x1 || y0 >= y1) {
+			out[0] = *this;
+			return 1;
+		}
+		//full width above and below the hole, then either side of it
+		uint8_t n = 0;
+		if (y0 > Y)     out[n++].set(X, Y, W, y0-Y);
+		if (Y+H > y1)   out[n++].set(X, y1, W, Y+H-y1);
+		if (x0 > X)     out[n++].set(X, y0, x0-X, y1-y0);
+		if (X+W > x1)   out[n++].set(x1, y0, X+W-x1, y1-y0);
+		return n;
+	}
+};
+
+class Card;
+
+//a link to another card, by its place in the card pool counting from 1 and
+//0 for none, that reads and assigns like a Card*
+class CardLink {
+public:
+	CardLink(): mIndex(0) {}
+	inline operator Card*() const;
+	inline Card* operator->() const;
+	inline CardLink& operator=(Card* c);
+private:
+	uint8_t mIndex;
+};
+
+//where a card was last drawn, a byte a value is plenty on a 160x128 screen
+struct CardRect {
+	uint8_t X, Y, W, H;
+	void zero() {
+		X = 0; Y = 0; W = 0; H = 0;
+	}
+	void set(uint8_t x, uint8_t y, uint8_t w, uint8_t h) {
+		X = x; Y = y; W = w; H = h;
+	}
+	operator Rect() const {
+		Rect r;
+		r.set(X, Y, W, H);
+		return r;
+	}
 };
 
 class Card {
@@ -153,27 +259,42 @@ public:
 	};
 
 public:
-	Card(): Next(0), Prev(0), FaceUp(true), Highlight(0), Location(LocationDeck), 
+	Card(): FaceUp(true), Highlight(0), Location(LocationDeck), 
 		Which(CardId(CardId::NumZone, CardId::Hearts)) {
 		LastDrawnAt.zero();
 	}
-	Card(CardId which): Next(0), Prev(0), FaceUp(true), Highlight(0), 
-		Location(LocationDeck), Which(which) {
-		LastDrawnAt.zero();
-	}
 	//
 	bool isempty() const {return Which.getNumber() == CardId::NumZone; }
 	//
-	Rect LastDrawnAt;
+	CardRect LastDrawnAt;
 	//
-	Card* Next;
-	Card* Prev;
-	bool FaceUp;
-	int Highlight; //is this card highlighted 0 => not, 1 => selection, 2 => target
-	Location Location;
-	const CardId Which;
+	CardLink Next;
+	CardLink Prev;
+	uint8_t FaceUp: 1;
+	uint8_t Highlight: 2; //is this card highlighted 0 => not, 1 => selection, 2 => target
+	uint8_t Location: 2;  //a Location
+	CardId Which;         //only set by Deck, the bases are NumZone
 };
 
+//every card there is lives here, 8 bytes each and nothing on the heap: the
+//52 of the deck in tohash() order, then the bases the columns and the
+//foundations are built on
+#define CARD_COLUMN_BASES     52
+#define CARD_FOUNDATION_BASES 59
+#define CARD_POOL             63
+static Card sCards[CARD_POOL];
+
+inline CardLink::operator Card*() const {
+	return mIndex ? &sCards[mIndex - 1] : 0;
+}
+inline Card* CardLink::operator->() const {
+	return &sCards[mIndex - 1];
+}
+inline CardLink& CardLink::operator=(Card* c) {
+	mIndex = c ? c - sCards + 1 : 0;
+	return *this;
+}
+
 
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -181,69 +302,124 @@ public:
 class Deck {
 public:
 	Deck() {
-		//call constructors using placement new
-		for (int i = 0; i < 52; ++i)
-			mDeck[i] = new Card(CardId::fromhash(i)); 
-	}
-	~Deck() {
-		//free the cards
-		for (int i = 0; i < 52; ++i)
-			delete mDeck[i];
+		for (int i = 0; i < 52; ++i) {
+			sCards[i].Which = CardId::fromhash(i);
+			mDeck[i] = i;
+		}
 	}
 
 	void shuffle() {
+		//back into the order the cards were made in first, so the shuffle only
+		//depends on the seed and a deal number always gives the same game
+		for (int i = 0; i < 52; ++i)
+			mDeck[i] = i;
 		//Fisher-Yates shuffle the deck
 		for (int i = 0; i < 52; ++i) {
 			int j = i + rand()%(52-i);
-			Card* tmp = mDeck[j];
+			uint8_t tmp = mDeck[j];
 			mDeck[j] = mDeck[i];
 			mDeck[i] = tmp;
 		}
 	}
 
 	Card* operator[](int8_t i) const {
-		return mDeck[i];
+		return &sCards[mDeck[i]];
 	}
 
 private:
-	Card* mDeck[52];
+	uint8_t mDeck[52]; //places in sCards
 };
 
 
 ///////////////////////////////////////////////////////////////////////////////
 // 
+#define MAX_SPRITES    56 //52 cards, the deck, and the two cursors (+1 spare)
+#define DRAW_BAND_ROWS 8  //background rows painted per slice
+#define CURSOR_OUTLINE_PIXELS 129 //pixels drawCursor() touches
+
+//cards that are put down or turned over slide into place
+#define MAX_FLYING      13    //the longest run that can be moved
+#define ANIM_MS         180   //length of a slide
+#define ANIM_FRAME_US   33333 //30fps
+#define ANIM_SPI_BUDGET 8000  //bytes a slide frame may send, half of what the
+                              //bus moves in a frame period at DIV4
+#define ANIM_CPU_BUDGET 25000 //us a slide frame may take
+
+//scoring, roughly the usual Klondike one
+#define SCORE_TO_FOUNDATION    10
+#define SCORE_WASTE_TO_TABLEAU 5
+#define SCORE_REVEAL           5
+#define SCORE_FROM_FOUNDATION  -15
+#define SCORE_RECYCLE          -20 //for going through the stock again
+
 class BoardState {
 public:
-	BoardState(): mDeck(0), mTopOfDeck(0) {
+	BoardState(): mDrawing(false), mNewDeal(false), mDealGroup(9), mCursorFrame(false),
+		mFlyQueued(0), mFlyCount(0), mAnimating(false), mAnimCost(0),
+		mDeck(0), mTopOfDeck(0) {
+		mFrameDirty.zero();
+		mAnimRect.zero();
+		mAnimDest.zero();
+		mHeldRect.zero();
+		mHeldCount = 0;
+		mHeldFrom = 0;
+		mMoves = 0;
+		mScore = 0;
+		mDealtAt = 0;
+		mWon = false;
+		mDeal = 0;
 		memset(mStacks, 0, 4*sizeof(Card*));
 		memset(mBoard, 0, 7*sizeof(Card*));
 		mSelectedColor = tft.Color565(220, 0, 140);
 		mGrabColor = tft.Color565(140, 0, 220);
+		mBorderColor = tft.Color565(200,200,200);
+		mBorderDarkerColor = tft.Color565(100,100,100);
+		mBackColor = tft.Color565(0, 50, 255);
+		memset(mFeltColors, 0, sizeof(mFeltColors));
 	}
 	~BoardState() {}
 
 	void initialize() {
-		//seed the randomness for the shuffle
-		for (int i = 0; i < 10; ++i)
-			srand(analogRead(7) + rand());
+		//pick the deal with the noise the input interrupts have been collecting
+		//off the ADC (analogRead() can't be used while they are running)
+		uint16_t deal = inputEntropy() + rand();
+		BENCH_DEAL(deal);
+		initialize(deal);
+	}
+	//deal number deal, the same number always gives the same game
+	void initialize(uint16_t deal) {
+		mDeal = deal;
+		srand(deal);
+		//a slightly different felt for every deal
+		for (uint8_t i = 0; i < 16; ++i)
+			mFeltColors[i] = tft.Color565(0, 150+rand()%45, 0);
 		//
 		mHasHeldCards = false;
+		mHeldCard = 0;
+		mCardToReveal = 0;
+		//new game on the HUD
+		mMoves = 0;
+		mScore = 0;
+		mDealtAt = millis();
+		mWon = false;
 		//start out the cursor in the right place
 		mCursorLocationX = 1;
 		mCursorLocationY = 0;
 		//shuffle the deck
 		mSourceDeck.shuffle();
-		//create an initial dirty region over the whole screen
+		//create an initial dirty region over the whole screen, the next frame
+		//streams the deal out a column at a time
 		mDirtyRegion.X = 0;
 		mDirtyRegion.Y = 0;
 		mDirtyRegion.W = 160;
 		mDirtyRegion.H = 128;
+		mNewDeal = true;
 		//
 		int8_t curCard = 0;
 
-		//deal out the piles
+		//deal out the piles, relinking the same 52 cards in the shuffled order
 		for (int pileN = 0; pileN < 7; ++pileN) {
-			Card* prev = &mBoardBases[pileN];
+			Card* prev = &sCards[CARD_COLUMN_BASES + pileN];
 			Card* first = prev;
 			prev->Prev = 0;
 			prev->Location = Card::LocationBoard;
@@ -264,7 +440,7 @@ public:
 
 		//init the stacks
 		for (int stackN = 0; stackN < 4; ++stackN) {
-			mStacks[stackN] = &mStackBases[stackN];
+			mStacks[stackN] = &sCards[CARD_FOUNDATION_BASES + stackN];
 			mStacks[stackN]->Next = 0;
 			mStacks[stackN]->Prev = 0;
 		} 
@@ -293,93 +469,97 @@ public:
 			if (mTopOfDeck->Next) {
 				//we have a top of deck, and a next, flip over the next cards
 				for (int i = 0; i < 3; ++i) {
-					if (mTopOfDeck->Next)
+					if (mTopOfDeck->Next) {
 						mTopOfDeck = mTopOfDeck->Next;
+						flyFromStock(mTopOfDeck);
+					}
 				}
 			} else {
 				//no next, flip the stack back into the deck
 				mTopOfDeck = 0;
+				addScore(SCORE_RECYCLE);
 			}
 		} else if (mDeck) {
 			//no top of deck, but a non-empty deck, deal from it
 			mTopOfDeck = mDeck;
+			flyFromStock(mTopOfDeck);
 			for (int i = 0; i < 2; ++i) {
-				if (mTopOfDeck->Next)
+				if (mTopOfDeck->Next) {
 					mTopOfDeck = mTopOfDeck->Next;
+					flyFromStock(mTopOfDeck);
+				}
 			}
 		}
 	}
 
 	///////////////////////////////////////////////////////////////////////////
 	// drawing code
-	void drawCard(const CardId& c, int atx, int aty, Card* cardHint, bool drawSmall = false) {
-		uint8_t drawSmallMod = drawSmall ? 12 : 0; 
-		//where we should draw
-		if (cardHint) {
-			cardHint->LastDrawnAt.X = atx;
-			cardHint->LastDrawnAt.Y = aty;
-			cardHint->LastDrawnAt.W = 21;
-			cardHint->LastDrawnAt.H = 28 - drawSmallMod;
-			if (!cardHint->LastDrawnAt.intersects(mDirtyRegion)) return;
-		}
-		//
-		static uint16_t borderColor = tft.Color565(200,200,200);
-		static uint16_t borderDarkerColor = tft.Color565(100,100,100);
-		tft.fillRect(atx, aty, 20, 26 - drawSmallMod, ST7735_WHITE);
-		tft.drawRect(atx, aty, 20, 26 - drawSmallMod, borderColor);
-		tft.drawFastHLine(atx+16, aty, 4, borderDarkerColor);
-		tft.drawFastVLine(atx+20, aty, 26 - drawSmallMod, borderDarkerColor);
-		//
-		int16_t cardColor = c.getColor() ? ST7735_BLACK : ST7735_RED;
-		//
+	// A frame is painted in slices so the main loop can keep handling input
+	// while it goes out. beginFrame() lays the board out into a display list
+	// of sprites in paint order, then every drawStep() paints one band of the
+	// felt or one sprite. Input that arrives mid-frame calls beginFrame()
+	// again: the stale frame is dropped, and whatever it had covered gets
+	// painted by the new one.
+	enum SpriteKind {
+		SpriteFace,
+		SpriteBack,
+		SpriteCursor,
+		SpriteGrabCursor,
+	};
+	struct Sprite {
+		Card* Which;       //card painted, null for the stock and cursors
+		uint8_t X, Y;      //a held card goes at most to y=240
+		unsigned Kind:   2;
+		unsigned Small:  1;
+		unsigned Flying: 1; //sliding into place, painted by animStep()
+		unsigned Stage:  4; //FrameStage the painting is charged to
+	};
+
+	//the corner glyphs of a card, returns how many went into cellX/cellChar,
+	//in the order they are drawn
+	static uint8_t cardGlyphs(const CardId& c, int8_t* cellX, char* cellChar) {
 		char symb = c.getSymbol();
-		int8_t suitoffset = 0;
 		if (symb == '0') {
 			//special handling for 10
-			suitoffset = 11;
-			tft.drawChar(atx+0, aty+1, '1', cardColor, ST7735_WHITE, 1);
-			tft.drawChar(atx+5, aty+1, '0', cardColor, ST7735_WHITE, 1);
-		} else {
-			suitoffset = 7;
-			tft.drawChar(atx+1, aty+1, symb, cardColor, ST7735_WHITE, 1);
+			cellX[0] = 0;  cellChar[0] = '1';
+			cellX[1] = 5;  cellChar[1] = '0';
+			cellX[2] = 11; cellChar[2] = c.getSuitSymbol();
+			return 3;
 		}
+		cellX[0] = 1; cellChar[0] = symb;
+		cellX[1] = 7; cellChar[1] = c.getSuitSymbol();
+		return 2;
+	}
+
+	void drawCard(const CardId& c, int atx, int aty, bool drawSmall = false) {
+		uint8_t drawSmallMod = drawSmall ? 12 : 0; 
+		tft.fillRect(atx, aty, 20, 26 - drawSmallMod, ST7735_WHITE);
+		tft.drawRect(atx, aty, 20, 26 - drawSmallMod, mBorderColor);
+		tft.drawFastHLine(atx+16, aty, 4, mBorderDarkerColor);
+		tft.drawFastVLine(atx+20, aty, 26 - drawSmallMod, mBorderDarkerColor);
 		//
-		tft.drawChar(atx+suitoffset, aty+1, c.getSuitSymbol(), cardColor, ST7735_WHITE, 1);
-		if (cardHint)
-			mDirtyRegion.expand(cardHint->LastDrawnAt);
+		int16_t cardColor = c.getColor() ? ST7735_BLACK : ST7735_RED;
+		int8_t cellX[3];
+		char cellChar[3];
+		uint8_t n = cardGlyphs(c, cellX, cellChar);
+		for (uint8_t i = 0; i < n; ++i)
+			drawGlyph(atx + cellX[i], aty+1, cellChar[i], cardColor, ST7735_WHITE);
 	}
-	void drawCardBack(int atx, int aty, Card* cardHint, bool drawSmall = false) {
+	void drawCardBack(int atx, int aty, bool drawSmall = false) {
 		uint8_t drawSmallMod = drawSmall ? 12 : 0; 
-		//where we would draw
-		if (cardHint) {
-			cardHint->LastDrawnAt.X = atx;
-			cardHint->LastDrawnAt.Y = aty;
-			cardHint->LastDrawnAt.W = 21;
-			cardHint->LastDrawnAt.H = 28 - drawSmallMod;
-			if (!cardHint->LastDrawnAt.intersects(mDirtyRegion)) return;
-		}
-		static uint16_t borderColor = tft.Color565(200,200,200);
-		static uint16_t borderDarkerColor = tft.Color565(100,100,100);
-		static uint16_t backBlue = tft.Color565(0, 50, 255);
 		tft.fillRect(atx, aty, 20, 26 - drawSmallMod, ST7735_WHITE);
-		tft.fillRect(atx+2, aty+2, 16, 22 - drawSmallMod + (drawSmall ? 3 : 0), backBlue);
-		tft.drawRect(atx, aty, 20, 26 - drawSmallMod, borderColor);
-		tft.drawFastHLine(atx+16, aty, 4, borderDarkerColor);
-		tft.drawFastVLine(atx+20, aty, 26 - drawSmallMod, borderDarkerColor);
-		if (cardHint)
-			mDirtyRegion.expand(cardHint->LastDrawnAt);
+		tft.fillRect(atx+2, aty+2, 16, 22 - drawSmallMod + (drawSmall ? 3 : 0), mBackColor);
+		tft.drawRect(atx, aty, 20, 26 - drawSmallMod, mBorderColor);
+		tft.drawFastHLine(atx+16, aty, 4, mBorderDarkerColor);
+		tft.drawFastVLine(atx+20, aty, 26 - drawSmallMod, mBorderDarkerColor);
 	}
 
 	void drawCursor(uint8_t x, uint8_t y) {
-		Rect r; r.X = x, r.Y = y; r.W = 21; r.H = 28; 
-		mDirtyRegion.expand(r);
 		tft.drawRect(x, y, 20, 26, mSelectedColor);
 		tft.drawFastVLine(x+1, y+7, 17, mSelectedColor);
 		tft.drawFastVLine(x+18, y+1, 24, mSelectedColor);
 	}
 	void drawGrabCursor(uint8_t x, uint8_t y) {
-		Rect r; r.X = x, r.Y = y; r.W = 21; r.H = 28; 
-		mDirtyRegion.expand(r);
 		tft.drawRect(x, y, 20, 26, mGrabColor);
 		tft.drawFastVLine(x+1, y+7, 17, mGrabColor);
 		tft.drawFastVLine(x+18, y+1, 24, mGrabColor);
@@ -389,59 +569,56 @@ public:
 		mDirtyRegion.expand(r);
 	}
 
-	void draw() {
-		//clamp the dirty region to the sceen size
-		if (mDirtyRegion.X < 0) mDirtyRegion.X = 0;
-		if (mDirtyRegion.Y < 0) mDirtyRegion.Y = 0;
-		if (mDirtyRegion.X + mDirtyRegion.W >` 160) mDirtyRegion.W = 160 - mDirtyRegion.X;
-		if (mDirtyRegion.Y + mDirtyRegion.H > 128) mDirtyRegion.H = 128 - mDirtyRegion.Y;
-
-		//background
-		static uint16_t bgcolor = tft.Color565(0,200,0);
-		static uint16_t bgcolors[16] = {
-			tft.Color565(0, 150+rand()%45, 0),
-			tft.Color565(0, 150+rand()%45, 0),
-			tft.Color565(0, 150+rand()%45, 0),
-			tft.Color565(0, 150+rand()%45, 0),
-			tft.Color565(0, 150+rand()%45, 0),
-			tft.Color565(0, 150+rand()%45, 0),
-			tft.Color565(0, 150+rand()%45, 0),
-			tft.Color565(0, 150+rand()%45, 0),
-			tft.Color565(0, 150+rand()%45, 0),
-			tft.Color565(0, 150+rand()%45, 0),
-			tft.Color565(0, 150+rand()%45, 0),
-			tft.Color565(0, 150+rand()%45, 0),
-			tft.Color565(0, 150+rand()%45, 0),
-			tft.Color565(0, 150+rand()%45, 0),
-			tft.Color565(0, 150+rand()%45, 0),
-			tft.Color565(0, 150+rand()%45, 0),
-		};
-		//tft.fillRect(mDirtyRegion.X, mDirtyRegion.Y, mDirtyRegion.W, mDirtyRegion.H, bgcolor);
-		tft.setAddrWindow(mDirtyRegion.X, mDirtyRegion.Y, 
-			              mDirtyRegion.X + mDirtyRegion.W, 
-			              mDirtyRegion.Y + mDirtyRegion.H);
+	//fill a region with the felt pattern
+	void drawBackground(const Rect& r) {
+		if (r.W <= 0 || r.H <= 0) return;
+		tft.setAddrWindow(r.X, r.Y, r.X + r.W - 1, r.Y + r.H - 1);
 		tft.fastPushColorBegin();
-		for (int y = mDirtyRegion.Y; y < mDirtyRegion.H+mDirtyRegion.Y; ++y) {
-			for (int x = mDirtyRegion.X; x < mDirtyRegion.W+mDirtyRegion.X; ++x) {
+		for (int y = r.Y; y < r.H+r.Y; ++y) {
+			for (int x = r.X; x < r.W+r.X; ++x) {
 				uint16_t i = x*y;
-				tft.fastPushColor(bgcolors[i%13]);
+				tft.fastPushColor(mFeltColors[i%13]);
 			}
 		}
 		tft.fastPushColorEnd();
+	}
+
+	void addSprite(Card* which, int x, int y, uint8_t kind, bool small, uint8_t stage) {
+		Sprite& s = mSprites[mSpriteCount++];
+		s.Which = which;
+		s.X = x;
+		s.Y = y;
+		s.Kind = kind;
+		s.Small = small;
+		s.Flying = false;
+		s.Stage = stage;
+		//where the card is on screen, for invalidating it later
+		if (which) {
+			which->LastDrawnAt.X = x;
+			which->LastDrawnAt.Y = y;
+			which->LastDrawnAt.W = 21;
+			which->LastDrawnAt.H = small ? 16 : 28;
+		}
+	}
+	void addCursor(int x, int y, uint8_t stage) {
+		addSprite(NULL, x, y, SpriteCursor, false, stage);
+		mCursorAtX = x;
+		mCursorAtY = y;
+	}
 
-		//draw the deck
+	//build the display list for the current board
+	void layout() {
+		mSpriteCount = 0;
+		mCursorAtX = 0;
+		mCursorAtY = 0;
+
+		//the deck
 		if (!mTopOfDeck || mTopOfDeck->Next)
-			drawCardBack(1, 2, NULL, true);
-		//handle cursor
+			addSprite(NULL, 1, 2, SpriteBack, true, StageDeck);
 		if (mCursorLocationX == 0 && mCursorLocationY == 0)
-			//draw the cursor
-			drawCursor(1, 2);
-
-		//track where we draw the cursor to draw the to-move cards hovering over it
-		int cursorAtX = 0;
-		int cursorAtY = 0;
+			addCursor(1, 2, StageDeck);
 
-		//draw the revealed deck cards
+		//the revealed deck cards
 		Card* cur = mTopOfDeck;
 		if (cur) {
 			//start with the card up to two cards back
@@ -455,15 +632,12 @@ public:
 			//
 			for (int i = 0; i < cardsToDraw; ++i) {
 				if (cur) {
-					//draw cur
-					drawCard(cur->Which, 22 + 14*i, 2, cur, true);
-					//if we're last, draw the draw cursor
+					addSprite(cur, 22 + 14*i, 2, SpriteFace, true, StageWaste);
+					//if we're last, add the draw cursor
 					if (mCursorLocationX == 1 && mCursorLocationY == 0 && 
 						(i == cardsToDraw-1 || !cur->Next)) 
 					{
-						drawCursor(22 + 14*i, 2);
-						cursorAtX = 22 + 14*i;
-						cursorAtY = 2;
+						addCursor(22 + 14*i, 2, StageWaste);
 					}
 					//traverse to the next card
 					cur = cur->Next;
@@ -471,76 +645,382 @@ public:
 			}
 		} else {
 			//no revealed? Special case for cursor
-			if (mCursorLocationX == 1 && mCursorLocationY == 0) {
-				drawCursor(22, 2);
-				cursorAtX = 22;
-				cursorAtY = 2;
-			}
+			if (mCursorLocationX == 1 && mCursorLocationY == 0)
+				addCursor(22, 2, StageWaste);
 		}
 
-		//draw the stacks
+		//the stacks
 		for (int stackN = 0; stackN < 4; ++stackN) {
 			cur = mStacks[stackN];
-			if (!cur->isempty()) {
-				drawCard(cur->Which, 75 + stackN*22, 2, cur, true);
-			}
-			//draw cursor, whether the stack has cards or not
-			if (mCursorLocationY == 0 && mCursorLocationX == stackN+2) {
-				drawCursor(75 + stackN*22, 2);
-				cursorAtX = 75 + stackN*22;
-				cursorAtY = 2;
-			}
+			if (!cur->isempty())
+				addSprite(cur, 75 + stackN*22, 2, SpriteFace, true, StageFoundations);
+			//cursor, whether the stack has cards or not
+			if (mCursorLocationY == 0 && mCursorLocationX == stackN+2)
+				addCursor(75 + stackN*22, 2, StageFoundations);
 		}
 
-		//draw the stacks on the board
+		//the stacks on the board
 		for (int stackN = 0; stackN < 7; ++stackN) {
 			cur = mBoard[stackN]->Next; //the first entry is the "base"
 			int depth = 0;
 			int cardN = 0;
 			//special case cursor for emyty col
-			if (!cur && mCursorLocationX == stackN && mCursorLocationY == 1) {
-				drawCursor(3 + 22*stackN, 17);
-				cursorAtX = 3 + 22*stackN;
-				cursorAtY = 17;
-			}
+			if (!cur && mCursorLocationX == stackN && mCursorLocationY == 1)
+				addCursor(3 + 22*stackN, 17, StageTableau);
 			while (cur) {
 				int oldDepth = depth;
 				if (cur->FaceUp) {
-					drawCard(cur->Which, 3 + 22*stackN, 17 + depth, cur);
+					addSprite(cur, 3 + 22*stackN, 17 + depth, SpriteFace, false, StageTableau);
 					depth += 8;
-					++cardN;
 				} else {
-					drawCardBack(3 + 22*stackN, 17 + depth, cur, cur->Next != 0);
+					addSprite(cur, 3 + 22*stackN, 17 + depth, SpriteBack, cur->Next != 0, StageTableau);
 					depth += 4;
-					++cardN;
-				}
-				if (mCursorLocationX == stackN && mCursorLocationY == cardN) {
-					drawCursor(3 + 22*stackN, 17 + oldDepth);
-					cursorAtX = 3 + 22*stackN;
-					cursorAtY = 17 + oldDepth;
 				}
+				++cardN;
+				if (mCursorLocationX == stackN && mCursorLocationY == cardN)
+					addCursor(3 + 22*stackN, 17 + oldDepth, StageTableau);
 				cur = cur->Next;
 			}
 		}
 
-		//draw the held cards hovering the cursor
+		//the held cards hovering the cursor
+		mHeldCount = 0;
+		mHeldRect.zero();
 		if (mHeldCard) {
-			int depth = 0;
-			drawCard(mHeldCard->Which, cursorAtX + 7, cursorAtY + 7, mHeldCard);
-			drawGrabCursor(cursorAtX + 7, cursorAtY + 7);
-			Card* cur = mHeldCard->Next;
-			while (cur) {
-				++depth;
-				drawCard(cur->Which, cursorAtX + 7, cursorAtY + 7 + depth*8, cur);
-				cur = cur->Next;
+			int x = mCursorAtX + 7, y = mCursorAtY + 7;
+			mHeldSprite = mSpriteCount;
+			addSprite(mHeldCard, x, y, SpriteFace, false, StageHeld);
+			addSprite(NULL, x, y, SpriteGrabCursor, false, StageHeld);
+			for (Card* cur = mHeldCard->Next; cur; cur = cur->Next) {
+				y += 8;
+				addSprite(cur, x, y, SpriteFace, false, StageHeld);
+				++mHeldCount;
+			}
+			++mHeldCount;
+			mHeldRect.set(x, mCursorAtY + 7, 21, y - mCursorAtY - 7 + 26);
+		}
+	}
+
+	//paint a sprite if it is in the region being repainted, true if it was
+	bool paintSprite(const Sprite& s) {
+		if (s.Flying) return false;
+		FRAME_STAGE(s.Stage);
+		Rect r; r.X = s.X; r.Y = s.Y; r.W = 21; r.H = s.Small ? 16 : 28;
+		switch (s.Kind) {
+		case SpriteFace:
+			if (!r.intersects(mPaintRegion)) return false;
+			drawCard(s.Which->Which, s.X, s.Y, s.Small);
+			break;
+		case SpriteBack:
+			if (!s.Which) {
+				//the deck is always painted, and doesn't grow the region
+				drawCardBack(s.X, s.Y, s.Small);
+				return true;
+			}
+			if (!r.intersects(mPaintRegion)) return false;
+			drawCardBack(s.X, s.Y, s.Small);
+			break;
+		case SpriteCursor:
+			drawCursor(s.X, s.Y);
+			break;
+		case SpriteGrabCursor:
+			drawGrabCursor(s.X, s.Y);
+			break;
+		}
+		//anything on top of what we just painted has to be repainted too
+		mPaintRegion.expand(r);
+		return true;
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// compositing from the display list
+	// Small updates don't go through the felt-then-sprites painter, they
+	// work out the final colour of each pixel from the display list and
+	// stream a rect out in one address window. spritePixel() mirrors exactly
+	// what the draw* functions above put on screen.
+	static bool onCursorOutline(int dx, int dy) {
+		if (dx < 0 || dx > 19 || dy < 0 || dy > 25) return false;
+		if (dx == 0 || dx == 19 || dy == 0 || dy == 25) return true;
+		return (dx == 1 && dy >= 7 && dy < 24) || (dx == 18 && dy < 25);
+	}
+
+	//colour sprite s leaves at (x, y), false if it doesn't paint there
+	bool spritePixel(const Sprite& s, int x, int y, uint16_t& color) const {
+		int dx = x - s.X, dy = y - s.Y;
+		if (dx < 0 || dx > 20 || dy < 0) return false;
+		int h = s.Small ? 14 : 26;
+		switch (s.Kind) {
+		case SpriteCursor:
+		case SpriteGrabCursor:
+			if (!onCursorOutline(dx, dy)) return false;
+			color = (s.Kind == SpriteCursor) ? mSelectedColor : mGrabColor;
+			return true;
+		case SpriteFace:
+			if (dy >= h) return false;
+			if (dy >= 1 && dy < 1+GLYPH_H) {
+				//the last glyph drawn over a column wins
+				int8_t cellX[3];
+				char cellChar[3];
+				uint8_t n = cardGlyphs(s.Which->Which, cellX, cellChar);
+				while (n--) {
+					if (dx < cellX[n] || dx >= cellX[n] + GLYPH_W) continue;
+					bool lit = glyphColumn(cellChar[n], dx - cellX[n]) & (1 << (dy-1));
+					color = !lit ? ST7735_WHITE :
+						(s.Which->Which.getColor() ? ST7735_BLACK : ST7735_RED);
+					return true;
+				}
+			}
+			break;
+		case SpriteBack:
+			//the blue of a small back spills one row past its border
+			if (s.Small && dy == h && dx >= 2 && dx < 18) {
+				color = mBackColor;
+				return true;
+			}
+			if (dy >= h) return false;
+			if (dx >= 2 && dx < 18 && dy >= 2 && dy < h-1 && dy < 24) {
+				color = mBackColor;
+				return true;
+			}
+			break;
+		}
+		//the frame around a card
+		if (dx == 20 || (dy == 0 && dx >= 16))
+			color = mBorderDarkerColor;
+		else if (dx == 0 || dx == 19 || dy == 0 || dy == h-1)
+			color = mBorderColor;
+		else
+			color = ST7735_WHITE;
+		return true;
+	}
+	//the most a sprite can cover
+	static Rect spriteBounds(const Sprite& s) {
+		Rect r;
+		r.set(s.X, s.Y, 21, s.Small ? 15 : 26);
+		return r;
+	}
+
+	//final colour at (x, y), only looking at the sprites in hits
+	uint16_t pixelAt(int x, int y, const uint8_t* hits, uint8_t n) const {
+		uint16_t color;
+		//cards in flight are over everything, the later ones on top
+		if (mAnimating) {
+			uint8_t i = mFlyCount;
+			while (i--)
+				if (spritePixel(mSprites[mFlySprite[i]], x - mFlyDX[i], y - mFlyDY[i], color))
+					return color;
+		}
+		//nothing is above the held run, and every card in it hides all but
+		//the top 8 rows of the one before, so which card is on top at a
+		//point follows from its offset into the run
+		int dx = x - mHeldRect.X, dy = y - mHeldRect.Y;
+		if (mHeldCount && dx >= 0 && dx < mHeldRect.W && dy >= 0 && dy < mHeldRect.H) {
+			uint8_t i = min(dy >> 3, mHeldCount - 1);
+			//the grab cursor is over the first card, and under the rest
+			if (i == 0 && spritePixel(mSprites[mHeldSprite+1], x, y, color))
+				return color;
+			spritePixel(mSprites[mHeldSprite + (i ? i+1 : 0)], x, y, color);
+			return color;
+		}
+		while (n--)
+			if (spritePixel(mSprites[hits[n]], x, y, color))
+				return color;
+		return mFeltColors[(uint16_t)(x*y) % 13];
+	}
+
+	//only the sprites that touch a rect need looking at per pixel, their
+	//indices go in hits
+	uint8_t spritesIn(const Rect& r, uint8_t* hits) const {
+		uint8_t n = 0;
+		for (uint8_t i = 0; i < mSpriteCount; ++i)
+			if (!(mAnimating && mSprites[i].Flying) && spriteBounds(mSprites[i]).intersects(r))
+				hits[n++] = i;
+		return n;
+	}
+
+	//repaint a rect with what the display list says should be there
+	void paintRect(const Rect& area) {
+		Rect r = area;
+		if (r.X < 0) { r.W += r.X; r.X = 0; }
+		if (r.Y < 0) { r.H += r.Y; r.Y = 0; }
+		if (r.X + r.W > 160) r.W = 160 - r.X;
+		if (r.Y + r.H > 128) r.H = 128 - r.Y;
+		if (r.W <= 0 || r.H <= 0) return;
+		mHud.invalidate(r.X, r.Y, r.W, r.H);
+		uint8_t hits[MAX_SPRITES];
+		uint8_t n = spritesIn(r, hits);
+		tft.setAddrWindow(r.X, r.Y, r.X + r.W - 1, r.Y + r.H - 1);
+		tft.fastPushColorBegin();
+		for (int y = r.Y; y < r.Y + r.H; ++y)
+			for (int x = r.X; x < r.X + r.W; ++x)
+				tft.fastPushColor(pixelAt(x, y, hits, n));
+		tft.fastPushColorEnd();
+	}
+
+	//draw the HUD cells that changed, the lit pixels of each glyph over what
+	//the display list has under it, so no card is hidden behind the line.
+	//Text over a card face goes black so it can still be read
+	void paintHud() {
+		for (uint8_t i = mHud.nextChanged(0); i < HUD_CELLS; i = mHud.nextChanged(i+1)) {
+			Rect r;
+			r.set(HUD_X + i*GLYPH_W, HUD_Y, GLYPH_W, GLYPH_H);
+			uint8_t hits[MAX_SPRITES];
+			uint8_t n = spritesIn(r, hits);
+			uint8_t columns[GLYPH_W];
+			for (uint8_t col = 0; col < GLYPH_W; ++col)
+				columns[col] = glyphColumn(mHud.cell(i), col);
+			tft.setAddrWindow(r.X, r.Y, r.X + GLYPH_W - 1, r.Y + GLYPH_H - 1);
+			tft.fastPushColorBegin();
+			for (uint8_t row = 0; row < GLYPH_H; ++row) {
+				for (uint8_t col = 0; col < GLYPH_W; ++col) {
+					uint16_t under = pixelAt(r.X + col, r.Y + row, hits, n);
+					if (columns[col] & (1 << row))
+						under = (under == ST7735_WHITE) ? ST7735_BLACK : ST7735_WHITE;
+					tft.fastPushColor(under);
+				}
+			}
+			tft.fastPushColorEnd();
+			mHud.drawn(i);
+		}
+	}
+
+	//repaint the pixels drawCursor() would touch at (x, y), a window each
+	//for the six lines
+	void paintCursorOutline(int x, int y) {
+		static const int8_t lines[6][4] = {
+			{0, 0, 20, 1}, {0, 25, 20, 1}, {0, 1, 1, 24},
+			{19, 1, 1, 24}, {1, 7, 1, 17}, {18, 1, 1, 24},
+		};
+		for (uint8_t i = 0; i < 6; ++i) {
+			Rect r;
+			r.set(x + lines[i][0], y + lines[i][1], lines[i][2], lines[i][3]);
+			paintRect(r);
+		}
+	}
+
+	//the pixels a sprite paints over completely
+	static Rect spriteCover(const Sprite& s) {
+		Rect r;
+		r.set(s.X, s.Y, 21, s.Small ? 14 : 26);
+		return r;
+	}
+	//cards of a new deal painted by dealStep(), 0 is the top row, 1-7 the
+	//columns and the cursors come last
+	static uint8_t dealGroup(const Sprite& s) {
+		if (s.Kind == SpriteCursor || s.Kind == SpriteGrabCursor)
+			return 8;
+		if (s.Stage != StageTableau)
+			return 0;
+		return (s.X - 3)/22 + 1;
+	}
+
+	//paint one group of a new deal: the felt of that part of the screen
+	//(except where its cards go anyway), then the cards
+	void dealStep() {
+		Rect area;
+		if (mDealGroup == 0) {
+			area.set(0, 0, 160, 17);
+		} else {
+			//each column's strip runs up to the right edge of its cards
+			int n = mDealGroup - 1;
+			int left = (n == 0) ? 0 : 22*n + 2;
+			int right = (n == 6) ? 160 : 22*n + 24;
+			area.set(left, 17, right - left, 111);
+		}
+		if (mDealGroup < 8) {
+			//the cards grow the cover while it stays completely painted by
+			//them: side by side in the top row, overlapping down a column
+			Rect cover;
+			cover.zero();
+			for (uint8_t i = 0; i < mSpriteCount; ++i) {
+				if (dealGroup(mSprites[i]) != mDealGroup) continue;
+				Rect r = spriteCover(mSprites[i]);
+				if (cover.W == 0 ||
+					(r.Y == cover.Y && r.H == cover.H && r.X <= cover.X + cover.W && r.X >= cover.X) ||
+					(r.X == cover.X && r.W == cover.W && r.Y <= cover.Y + cover.H && r.Y >= cover.Y))
+					cover.expand(r);
+			}
+			FRAME_STAGE(StageBackground);
+			Rect felt[4];
+			uint8_t n = area.subtract(cover, felt);
+			for (uint8_t i = 0; i < n; ++i)
+				drawBackground(felt[i]);
+		}
+		for (uint8_t i = 0; i < mSpriteCount; ++i)
+			if (dealGroup(mSprites[i]) == mDealGroup)
+				paintSprite(mSprites[i]);
+		++mDealGroup;
+	}
+
+	//start painting a new frame, dropping the one in progress if any.
+	//cursorOnly says the board is the same and only the cursor moved
+	void beginFrame(bool cursorOnly = false) {
+		//with nothing else to repaint, just move the cursor outline and the
+		//held run. If they haven't been moved on screen since the last input,
+		//it is still the ones from before that which need erasing
+		bool nothingElse = (mDirtyRegion.X == mFrameDirty.X && mDirtyRegion.Y == mFrameDirty.Y &&
+			mDirtyRegion.W == mFrameDirty.W && mDirtyRegion.H == mFrameDirty.H);
+		if (cursorOnly && nothingElse && !mFlyCount && (!mDrawing || mCursorFrame)) {
+			if (!mCursorFrame) {
+				mOldCursorX = mCursorAtX;
+				mOldCursorY = mCursorAtY;
+				mOldHeldRect = mHeldRect;
 			}
+			layout();
+			mCursorFrame = true;
+			mDrawing = true;
+			mDealGroup = 9;
+			//if this frame gets dropped, what is on screen is left to repaint
+			mPaintRegion.set(mOldCursorX, mOldCursorY, 21, 28);
+			mPaintRegion.expand(mOldHeldRect);
+			resetDirtyRegion();
+			return;
+		}
+		mCursorFrame = false;
+
+		//whatever the dropped frame had started painting needs to be redone
+		if (mDrawing)
+			mDirtyRegion.expand(mPaintRegion);
+		//and a slide that is still going, or hasn't started, is cut short: the
+		//cards are painted where they belong by this frame
+		if (mFlyCount) {
+			mDirtyRegion.expand(mAnimRect);
+			mDirtyRegion.expand(mAnimDest);
+			mAnimating = false;
+			mFlyCount = 0;
+		}
+		//clamp the dirty region to the sceen size
+		if (mDirtyRegion.X < 0) mDirtyRegion.X = 0;
+		if (mDirtyRegion.Y < 0) mDirtyRegion.Y = 0;
+		if (mDirtyRegion.X + mDirtyRegion.W > 160) mDirtyRegion.W = 160 - mDirtyRegion.X;
+		if (mDirtyRegion.Y + mDirtyRegion.H > 128) mDirtyRegion.H = 128 - mDirtyRegion.Y;
+		mLastDrawArea = mDirtyRegion.W * mDirtyRegion.H;
+		mPaintRegion = mDirtyRegion;
+		mPaintRow = mPaintRegion.Y;
+		mPaintSprite = 0;
+		mDrawing = true;
+		//where the cards the action moved were, before layout() moves them
+		int oldX[MAX_FLYING], oldY[MAX_FLYING];
+		for (uint8_t i = 0; i < mFlyQueued; ++i) {
+			oldX[i] = mFlyCards[i]->LastDrawnAt.X;
+			oldY[i] = mFlyCards[i]->LastDrawnAt.Y;
 		}
+		layout();
+		//a fresh deal goes out a column at a time rather than felt first
+		mDealGroup = mNewDeal ? 0 : 9;
+		if (!mNewDeal)
+			layoutFlying(oldX, oldY);
+		mFlyQueued = 0;
+		mNewDeal = false;
+		resetDirtyRegion();
+	}
 
+	void resetDirtyRegion() {
 		//set the new dirty rect to where the cursor is to start out with, we
 		//always have to update that region. Also add on the held cards if we have
 		//some. Other things can be added elsewhere
-		mDirtyRegion.X = cursorAtX;
-		mDirtyRegion.Y = cursorAtY;
+		mDirtyRegion.X = mCursorAtX;
+		mDirtyRegion.Y = mCursorAtY;
 		mDirtyRegion.W = 20;
 		mDirtyRegion.H = 29;
 		//add on held
@@ -551,9 +1031,223 @@ public:
 				cur = cur->Next;
 			}
 		}
+		mFrameDirty = mDirtyRegion;
+	}
+
+	//paint the next slice of the frame, true once it is complete
+	bool drawStep() {
+		if (!mDrawing) return true;
+		if (mCursorFrame) {
+			FRAME_STAGE(StageCursor);
+			paintCursorOutline(mOldCursorX, mOldCursorY);
+			paintCursorOutline(mCursorAtX, mCursorAtY);
+			mLastDrawArea = 2*CURSOR_OUTLINE_PIXELS;
+			if (mHeldCount) {
+				//the held run: what the move uncovered, then where it is now
+				FRAME_STAGE(StageHeld);
+				Rect exposed[4];
+				uint8_t n = mOldHeldRect.subtract(mHeldRect, exposed);
+				for (uint8_t i = 0; i < n; ++i) {
+					paintRect(exposed[i]);
+					mLastDrawArea += exposed[i].W * exposed[i].H;
+				}
+				paintRect(mHeldRect);
+				mLastDrawArea += mHeldRect.W * mHeldRect.H;
+			}
+			mCursorFrame = false;
+			mDrawing = false;
+		} else if (mDealGroup <= 8) {
+			dealStep();
+			mDrawing = (mDealGroup <= 8);
+			if (!mDrawing)
+				mHud.invalidateAll();
+		} else {
+			paintStep();
+		}
+		//the HUD goes back over whatever the frame painted under it
+		if (!mDrawing) {
+			FRAME_STAGE(StageHud);
+			mHud.update(mMoves, elapsedSeconds(), mScore);
+			paintHud();
+			//then the moved cards start sliding in
+			if (mFlyCount) {
+				mAnimating = true;
+				mAnimStartedAt = micros();
+				mAnimNextAt = mAnimStartedAt;
+			}
+		}
+		return !mDrawing;
+	}
+	//felt band or sprite of a normal frame
+	void paintStep() {
+		int bottom = mPaintRegion.Y + mPaintRegion.H;
+		if (mPaintRow < bottom) {
+			//a band of the background
+			FRAME_STAGE(StageBackground);
+			Rect band = mPaintRegion;
+			band.Y = mPaintRow;
+			band.H = min(DRAW_BAND_ROWS, bottom - mPaintRow);
+			drawBackground(band);
+			mPaintRow += band.H;
+		} else {
+			//the next sprite that needs painting
+			while (mPaintSprite < mSpriteCount && !paintSprite(mSprites[mPaintSprite]))
+				++mPaintSprite;
+			if (mPaintSprite < mSpriteCount)
+				++mPaintSprite;
+		}
+		mDrawing = (mPaintRow < bottom || mPaintSprite < mSpriteCount);
+		if (!mDrawing)
+			mHud.invalidate(mPaintRegion.X, mPaintRegion.Y, mPaintRegion.W, mPaintRegion.H);
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// card slides
+	// The cards an action moved are left out of the frame that repaints the
+	// board, then slide from where they were drawn last to their new place on
+	// top of everything else. Every slide frame composites what they uncovered
+	// and where they are now. Their position follows the clock, so a frame
+	// that would go over the SPI or CPU budget is skipped rather than slowing
+	// the slide down, and any new input cuts it short.
+
+	//have a card the action moved slide into its new place
+	void flyCard(Card* c) {
+		if (mFlyQueued < MAX_FLYING)
+			mFlyCards[mFlyQueued++] = c;
+	}
+	//a card turned over slides out of the stock
+	void flyFromStock(Card* c) {
+		c->LastDrawnAt.set(1, 2, 21, 16);
+		flyCard(c);
+	}
+
+	//pair the queued cards with their sprites in the new display list, oldX
+	//and oldY are where they were on screen before
+	void layoutFlying(const int* oldX, const int* oldY) {
+		mFlyCount = 0;
+		mAnimRect.zero();
+		mAnimDest.zero();
+		for (uint8_t i = 0; i < mFlyQueued; ++i) {
+			for (uint8_t j = 0; j < mSpriteCount; ++j) {
+				Sprite& s = mSprites[j];
+				if (s.Which != mFlyCards[i]) continue;
+				if (s.X != oldX[i] || s.Y != oldY[i]) {
+					s.Flying = true;
+					mFlySprite[mFlyCount] = j;
+					mFlyFromDX[mFlyCount] = oldX[i] - s.X;
+					mFlyFromDY[mFlyCount] = oldY[i] - s.Y;
+					++mFlyCount;
+					mAnimDest.expand(spriteBounds(s));
+				}
+				break;
+			}
+		}
+	}
+
+	//paint the next frame of the slide if one is due, false once it is over
+	bool animStep() {
+		if (!mAnimating) return false;
+		unsigned long now = micros();
+		if ((long)(now - mAnimNextAt) < 0) return true;
+		mAnimNextAt = now + ANIM_FRAME_US;
+		unsigned long elapsed = now - mAnimStartedAt;
+		bool last = elapsed >= ANIM_MS*1000UL;
+		//easing out, r/256 of the way is left and the offset goes with its square
+		long r = last ? 0 : 256 - (long)(elapsed*256/(ANIM_MS*1000UL));
+		int dx[MAX_FLYING], dy[MAX_FLYING];
+		Rect to;
+		to.zero();
+		for (uint8_t i = 0; i < mFlyCount; ++i) {
+			dx[i] = (mFlyFromDX[i]*r*r) >> 16;
+			dy[i] = (mFlyFromDY[i]*r*r) >> 16;
+			Rect b = spriteBounds(mSprites[mFlySprite[i]]);
+			b.X += dx[i];
+			b.Y += dy[i];
+			to.expand(b);
+		}
+		//what the frame costs: the uncovered strips and the cards, a window each
+		Rect exposed[4];
+		uint8_t n = mAnimRect.subtract(to, exposed);
+		uint32_t pixels = (uint32_t)to.W * to.H;
+		for (uint8_t i = 0; i < n; ++i)
+			pixels += (uint32_t)exposed[i].W * exposed[i].H;
+		uint32_t bytes = 2*pixels + 11*(n+1);
+		//the CPU budget only counts once a frame has been timed, a guess could
+		//skip every frame of a big slide and never be corrected
+		if (!last && (bytes > ANIM_SPI_BUDGET || ((pixels*mAnimCost) >> 10) > ANIM_CPU_BUDGET))
+			return true;
+		//
+		for (uint8_t i = 0; i < mFlyCount; ++i) {
+			mFlyDX[i] = dx[i];
+			mFlyDY[i] = dy[i];
+		}
+		if (last) {
+			//landed, back in their places in the display list
+			for (uint8_t i = 0; i < mFlyCount; ++i)
+				mSprites[mFlySprite[i]].Flying = false;
+			mAnimating = false;
+			mFlyCount = 0;
+		}
+		for (uint8_t i = 0; i < n; ++i)
+			paintRect(exposed[i]);
+		paintRect(to);
+		mAnimRect = to;
+		paintHud();
+		//keep the cost per pixel up to date for the CPU budget, the first
+		//frame drawn sets it outright
+		unsigned long took = micros() - now;
+		if (pixels) {
+			unsigned long cost = max(1UL, min(65535UL, (took << 10)/pixels));
+			mAnimCost = mAnimCost ? (3UL*mAnimCost + cost)/4 : cost;
+		}
+		return mAnimating;
+	}
+
+	//keep the clock on the HUD going between frames
+	void tickHud() {
+		mHud.update(mMoves, elapsedSeconds(), mScore);
+		if (!mDrawing)
+			paintHud();
+	}
+	uint16_t dealNumber() const { return mDeal; }
+	uint16_t elapsedSeconds() const {
+		return (mWon ? mWonAt : millis() - mDealtAt) / 1000;
+	}
+	bool drawing() const { return mDrawing; }
+	bool holding() const { return mHeldCard != 0; }
+	bool won() const { return mWon; }
+	//something drawn over the board has gone, the next frame repaints under it
+	void invalidate(int x, int y, int w, int h) {
+		Rect r; r.X = x; r.Y = y; r.W = w; r.H = h;
+		mDirtyRegion.expand(r);
+	}
+	//the first (top) of the cards being carried, and how many there are
+	const Card* held(uint8_t& count) const {
+		count = 0;
+		for (Card* cur = mHeldCard; cur; cur = cur->Next)
+			++count;
+		return mHeldCard;
+	}
+	uint16_t moves() const { return mMoves; }
+	//the number on top of each foundation, 4 bits each, 0 for an empty one
+	uint16_t foundations() const {
+		uint16_t f = 0;
+		for (int i = 0; i < 4; ++i)
+			f |= mStacks[i]->Which.getNumber() << 4*i;
+		return f;
+	}
+	//the cells left of the HUD's status line, drawn by the next tickHud()
+	void setHudPanel(const char* cells) { mHud.setPanel(cells); }
 
+	//paint a whole frame in one go
+	void draw() {
+		beginFrame();
+		while (!drawStep());
 	}
 
+	//size of the region repainted by the last draw(), in pixels
+	uint16_t lastDrawArea() const { return mLastDrawArea; }
+
 	///////////////////////////////////////////////////////////////////////////
 	// main action code
 	uint8_t getBoardStackSize(uint8_t n) {
@@ -637,7 +1331,200 @@ public:
 			}
 		}
 	}
+	//CRC-16 of where every card is and of the cursor, to check a replay against
+	uint16_t stateHash() const {
+		uint16_t crc = 0xFFFF;
+		for (int i = 0; i < 7; ++i) {
+			for (Card* cur = mBoard[i]->Next; cur; cur = cur->Next)
+				crc = _crc16_update(crc, cur->Which.tohash() | (cur->FaceUp ? 0x80 : 0));
+			crc = _crc16_update(crc, 0xFF);
+		}
+		for (int i = 0; i < 4; ++i)
+			crc = _crc16_update(crc, mStacks[i]->isempty() ? 0xFF : mStacks[i]->Which.tohash());
+		for (Card* cur = mDeck; cur; cur = cur->Next)
+			crc = _crc16_update(crc, cur->Which.tohash() | (cur == mTopOfDeck ? 0x80 : 0));
+		for (Card* cur = mHeldCard; cur; cur = cur->Next)
+			crc = _crc16_update(crc, cur->Which.tohash() | 0x40);
+		crc = _crc16_update(crc, mCursorLocationX);
+		return _crc16_update(crc, mCursorLocationY);
+	}
+	//mark a card as placed by restore(), false if it already was
+	static bool claim(Card* c, uint8_t* seen) {
+		int8_t h = c->Which.tohash();
+		if (seen[h >> 3] & (1 << (h & 7))) return false;
+		seen[h >> 3] |= 1 << (h & 7);
+		return true;
+	}
+	//the card with a given tohash()
+	Card* cardByHash(int8_t hash) {
+		return (hash >= 0 && hash < 52) ? &sCards[hash] : 0;
+	}
+
+	//pack the game into SAVE_PAYLOAD bytes. Face down cards never move and the
+	//stock keeps its order, so the deal number stands in for those and only
+	//what play has changed goes in: the foundations as their top card, the
+	//face up run of each column as its first card and one bit per card after
+	//that for which suit of the other colour it is, and a bit per card of the
+	//stock for whether it is still there
+	bool snapshot(uint8_t* buf) const {
+		BitWriter w(buf, SAVE_PAYLOAD);
+		w.put(mDeal, 16);
+		w.put(mMoves, 16);
+		w.put(mScore, 16);
+		w.put(elapsedSeconds(), 16);
+		w.put(mCursorLocationX, 3);
+		w.put(mCursorLocationY, 5);
+		for (int i = 0; i < 4; ++i) {
+			const CardId& top = mStacks[i]->Which;
+			w.put(top.getNumber(), 4);
+			w.put(top.getSuit(), 2);
+		}
+		for (int i = 0; i < 7; ++i) {
+			uint8_t down = 0, up = 0;
+			Card* cur = mBoard[i]->Next;
+			while (cur && !cur->FaceUp) {
+				++down;
+				cur = cur->Next;
+			}
+			for (Card* c = cur; c; c = c->Next)
+				++up;
+			w.put(down, 3);
+			w.put(up, 4);
+			if (cur) {
+				w.put(cur->Which.tohash(), 6);
+				for (Card* c = cur->Next; c; c = c->Next)
+					w.put(c->Which.getSuit() >> 1, 1);
+			}
+		}
+		uint8_t left = 0, top = 0;
+		for (int8_t k = 0; k < 24; ++k) {
+			const Card* c = mSourceDeck[28 + k];
+			bool in = (c->Location == Card::LocationDeck);
+			w.put(in, 1);
+			if (in)
+				++left;
+			if (c == mTopOfDeck)
+				top = left;
+		}
+		w.put(top, 5);
+		return !w.overflowed();
+	}
+
+	//carry on with the game in a snapshot(), false if it doesn't make sense
+	//(and the board is left in a state only initialize() can fix)
+	bool restore(const uint8_t* buf) {
+		BitReader r(buf);
+		initialize(r.get(16));
+		mMoves = r.get(16);
+		mScore = r.get(16);
+		unsigned long elapsed = r.get(16) * 1000UL;
+		mDealtAt = millis() - elapsed;
+		mCursorLocationX = r.get(3);
+		mCursorLocationY = r.get(5);
+		//every card has to turn up exactly once
+		uint8_t seen[7];
+		memset(seen, 0, sizeof(seen));
+		uint8_t count = 0;
+		//the foundations, up from the ace
+		for (int i = 0; i < 4; ++i) {
+			uint8_t n = r.get(4), suit = r.get(2);
+			if (n > 13) return false;
+			Card* prev = mStacks[i];
+			for (uint8_t k = 0; k < n; ++k) {
+				Card* c = cardByHash(suit*13 + k);
+				if (!claim(c, seen)) return false;
+				prev->Next = c;
+				c->Prev = prev;
+				c->Next = 0;
+				c->Location = Card::LocationStack;
+				c->FaceUp = true;
+				prev = c;
+				++count;
+			}
+			mStacks[i] = prev;
+		}
+		//the columns keep the face down cards they were dealt
+		for (int i = 0; i < 7; ++i) {
+			uint8_t down = r.get(3), up = r.get(4);
+			if (down > i || (down && !up)) return false;
+			Card* prev = mBoard[i];
+			for (uint8_t k = 0; k < down; ++k) {
+				prev = prev->Next;
+				prev->FaceUp = false;
+				if (!claim(prev, seen)) return false;
+				++count;
+			}
+			int8_t h = up ? r.get(6) : 0;
+			for (uint8_t k = 0; k < up; ++k) {
+				if (k) {
+					//one lower, in the other colour
+					if (h % 13 == 0) return false;
+					uint8_t suit = (1 - ((h / 13) & 1)) | (r.get(1) << 1);
+					h = suit*13 + h % 13 - 1;
+				}
+				if (h >= 52) return false;
+				Card* c = cardByHash(h);
+				if (!claim(c, seen)) return false;
+				prev->Next = c;
+				c->Prev = prev;
+				c->Location = Card::LocationBoard;
+				c->FaceUp = true;
+				prev = c;
+				++count;
+			}
+			prev->Next = 0;
+		}
+		//what is left of the stock, in the order it was dealt
+		Card* prev = 0;
+		uint8_t left = 0;
+		mDeck = 0;
+		for (int8_t k = 0; k < 24; ++k) {
+			Card* c = mSourceDeck[28 + k];
+			if (!r.get(1)) continue;
+			if (!claim(c, seen)) return false;
+			c->Location = Card::LocationDeck;
+			c->Prev = prev;
+			c->Next = 0;
+			if (prev)
+				prev->Next = c;
+			else
+				mDeck = c;
+			prev = c;
+			++left;
+			++count;
+		}
+		uint8_t top = r.get(5);
+		if (count != 52 || top > left) return false;
+		mTopOfDeck = 0;
+		for (Card* c = mDeck; top; --top, c = c->Next)
+			mTopOfDeck = c;
+		//
+		if (allFoundationsDone()) {
+			mWon = true;
+			mWonAt = elapsed;
+		}
+		//the cursor only has to be somewhere it can be
+		if (mCursorLocationY == 0 ? mCursorLocationX > 5 :
+			(mCursorLocationX > 6 || mCursorLocationY > max(1, getBoardStackSize(mCursorLocationX)))) {
+			mCursorLocationX = 1;
+			mCursorLocationY = 0;
+		}
+		return true;
+	}
+	void addScore(int points) {
+		mScore = max(0, mScore + points);
+	}
+	bool allFoundationsDone() {
+		for (int i = 0; i < 4; ++i)
+			if (mStacks[i]->Which.getNumber() != CardId::NumKing)
+				return false;
+		return true;
+	}
+
 	void putDownHeldCard() {
+		//putting the cards back where they came from isn't a move
+		Card* from = mHeldFrom;
+		bool moved = true;
 		//where to place it?
 		if (mCursorLocationY == 0) {
 			if (mCursorLocationX == 1) {
@@ -656,6 +1543,7 @@ public:
 				//change loc / faceup states
 				mHeldCard->Location = Card::LocationDeck;
 				mHeldCard->FaceUp = false;
+				moved = false;
 
 			} else if (mCursorLocationX > 1) {
 				//put on one of the stacks.
@@ -665,6 +1553,13 @@ public:
 				mHeldCard->Prev = base;
 				mHeldCard->Location = Card::LocationStack;
 				mStacks[stackN] = mHeldCard;
+				moved = (base != from);
+				if (moved && mHeldFromLocation != Card::LocationStack)
+					addScore(SCORE_TO_FOUNDATION);
+				if (allFoundationsDone() && !mWon) {
+					mWon = true;
+					mWonAt = millis() - mDealtAt;
+				}
 
 			} else {
 				error("mCursorLocation = (0,0) with card held");
@@ -682,16 +1577,27 @@ public:
 				cur->Location = Card::LocationBoard;
 				cur = cur->Next;
 			}
+			moved = (base != from);
+			if (moved && mHeldFromLocation == Card::LocationDeck)
+				addScore(SCORE_WASTE_TO_TABLEAU);
+			if (moved && mHeldFromLocation == Card::LocationStack)
+				addScore(SCORE_FROM_FOUNDATION);
 		}
 		//should we reveal a card?
 		//if we have on to reveal, and we didn't place the held card 
 		//back on the one to reveal, yes.
 		if (mCardToReveal && mCardToReveal != mHeldCard->Prev) {
 			mCardToReveal->FaceUp = true;
+			addScore(SCORE_REVEAL);
 			//update it
 			mDirtyRegion.expand(mCardToReveal->LastDrawnAt);
 		}
 
+		if (moved) {
+			++mMoves;
+			for (Card* cur = mHeldCard; cur; cur = cur->Next)
+				flyCard(cur);
+		}
 		//done placing
 		mHeldCard = 0;
 	}
@@ -703,6 +1609,7 @@ public:
 			if (mCursorLocationX == 0 && mCursorLocationY == 0) {
 				//reveal more
 				flip3();
+				++mMoves;
 				invalidateDeckRegion(); //need to redraw it fully
 			} else {
 				//pick up cards
@@ -731,6 +1638,8 @@ public:
 							mTopOfDeck = oldPrev;
 							//pick up
 							mHeldCard = card;
+							mHeldFrom = oldPrev;
+							mHeldFromLocation = Card::LocationDeck;
 							mHeldWasTopOfDeck = true;
 							mCardToReveal = 0;
 							//dirty the deck region, needs a redraw
@@ -742,6 +1651,8 @@ public:
 						Card* stackTop = mStacks[mCursorLocationX-2];
 						if (!stackTop->isempty()) {
 							//unlink
+							mHeldFrom = stackTop->Prev;
+							mHeldFromLocation = Card::LocationStack;
 							stackTop->Prev->Next = 0;
 							mStacks[mCursorLocationX-2] = stackTop->Prev;
 							stackTop->Prev = 0;
@@ -767,6 +1678,8 @@ public:
 						//Now, *CZZzXzx* Pick up that can!... I mean card!
 						//unlink
 						Card* oldPrev = card->Prev;
+						mHeldFrom = oldPrev;
+						mHeldFromLocation = Card::LocationBoard;
 						card->Prev->Next = 0;
 						card->Prev = 0;
 						//change stack location / faceup
@@ -860,6 +1773,16 @@ private:
 	bool mHeldWasTopOfDeck; //flag to know whether the picked up card is allowed to be
 	                        //placed back on the deck
 	Card* mCardToReveal; //card at the top of a stack to reveal on the cards being put down
+	Card* mHeldFrom;     //card the held ones were on (put back there, no move)
+	uint8_t mHeldFromLocation;
+	//HUD stuff
+	Hud mHud;
+	uint16_t mMoves;
+	int mScore;
+	unsigned long mDealtAt;
+	unsigned long mWonAt; //ms from the deal to the win
+	bool mWon;
+	uint16_t mDeal; //deal number, what initialize() seeded the shuffle with
 	//if we have a move, what locations could the cards being moved be placed
 	//at? There are at most 4+7+1 = 12 locations, so we can use a constant
 	//sized array to store them.
@@ -868,7 +1791,36 @@ private:
 	uint8_t mNumValidTargets;
 	uint8_t mValidTargets[12];
 	//drawing stuff
-	Rect mDirtyRegion;
+	Rect mDirtyRegion;  //what the next frame has to repaint
+	Rect mFrameDirty;   //what it was when the last frame started
+	Rect mPaintRegion;  //what the frame in progress is repainting
+	uint16_t mLastDrawArea;
+	Sprite mSprites[MAX_SPRITES];
+	uint8_t mSpriteCount;
+	uint8_t mPaintSprite; //next sprite to paint
+	int mPaintRow;        //next background row to paint
+	bool mDrawing;        //a frame is in progress
+	bool mNewDeal;        //initialize() dealt, the next frame streams it out
+	uint8_t mDealGroup;   //next part of the deal to paint, 9 when not dealing
+	int mCursorAtX, mCursorAtY;
+	bool mCursorFrame;    //the frame in progress only moves the cursor
+	int mOldCursorX, mOldCursorY; //where the cursor is on screen for it
+	Rect mOldHeldRect;            //and the held run
+	Rect mHeldRect;       //the held run in the display list
+	uint8_t mHeldSprite;  //its first card, followed by the grab cursor
+	uint8_t mHeldCount;
+	//card slides
+	Card* mFlyCards[MAX_FLYING]; //moved by the action, for the next frame
+	uint8_t mFlyQueued;
+	uint8_t mFlySprite[MAX_FLYING]; //their sprites once laid out
+	uint8_t mFlyCount;              //0 when there is no slide
+	int mFlyFromDX[MAX_FLYING], mFlyFromDY[MAX_FLYING]; //old minus new position
+	int mFlyDX[MAX_FLYING], mFlyDY[MAX_FLYING];         //offset on screen now
+	bool mAnimating;      //the slide has started
+	unsigned long mAnimStartedAt, mAnimNextAt;
+	Rect mAnimRect;       //where the flying cards are on screen
+	Rect mAnimDest;       //and where they land
+	uint16_t mAnimCost;   //us per 1024 pixels composited, 0 until measured
 	//
 	Deck mSourceDeck;
 	Card* mDeck;
@@ -876,20 +1828,274 @@ private:
 	Card* mStacks[4]; //pointer to the top card in a stack
 	Card* mBoard[7];  //pointer to the bottom card in a stack on the broad
 	//
-	Card mBoardBases[7];
-	Card mStackBases[4];
-	//
 	uint16_t mSelectedColor;
 	uint16_t mGrabColor;
+	uint16_t mBorderColor;
+	uint16_t mBorderDarkerColor;
+	uint16_t mBackColor;
+	uint16_t mFeltColors[16];
 } GameState;
 
 
+#ifdef SPI_BENCH
+#ifndef SPI_STATS
+#error "SPI_BENCH needs the SPI_STATS counters in the display driver"
+#endif
+///////////////////////////////////////////////////////////////////////////////
+// SPI traffic microbenchmarks
+// Runs each display primitive and each of the composites used by the board
+// renderer once, and prints what it cost on the bus as a JSON document over
+// Serial, so that runs from different commits can be compared with
+// tools/spicompare.py.
+class SpiBench {
+public:
+	SpiBench(): mFirst(true) {}
+
+	void begin(const char* name) {
+		mName = name;
+		mStart = tft.stats;
+		mStartedAt = micros();
+	}
+	void end() {
+		unsigned long took = micros() - mStartedAt;
+		ST7735Stats d = tft.stats - mStart;
+		Serial.print(mFirst ? "\n" : ",\n");
+		mFirst = false;
+		Serial.print("  {\"name\": \"");
+		Serial.print(mName);
+		Serial.print("\", \"command_bytes\": ");
+		Serial.print(d.commandBytes);
+		Serial.print(", \"data_bytes\": ");
+		Serial.print(d.dataBytes);
+		Serial.print(", \"cs_toggles\": ");
+		Serial.print(d.csToggles);
+		Serial.print(", \"est_us\": ");
+		Serial.print(d.estimateMicros());
+		Serial.print(", \"measured_us\": ");
+		Serial.print(took);
+		Serial.print("}");
+	}
+
+	void run() {
+		Serial.print("{\"spi_divider\": ");
+		Serial.print(ST7735_SPI_DIVIDER);
+		Serial.print(", \"results\": [");
+
+		//driver primitives
+		begin("fillScreen");     tft.fillScreen(ST7735_BLACK);                end();
+		begin("fillRect");       tft.fillRect(10, 10, 20, 26, ST7735_WHITE);  end();
+		begin("drawFastHLine");  tft.drawFastHLine(10, 40, 20, ST7735_RED);   end();
+		begin("drawFastVLine");  tft.drawFastVLine(40, 10, 26, ST7735_RED);   end();
+		begin("drawPixel");      tft.drawPixel(50, 50, ST7735_BLUE);          end();
+		begin("setAddrWindow");  tft.setAddrWindow(0, 0, 19, 25);            end();
+		begin("fastPushColor");
+		tft.fastPushColorBegin();
+		for (int i = 0; i < 20*26; ++i)
+			tft.fastPushColor(ST7735_GREEN);
+		tft.fastPushColorEnd();
+		end();
+
+		//board composites
+		Rect screen; screen.X = 0; screen.Y = 0; screen.W = 160; screen.H = 128;
+		Rect cardArea; cardArea.X = 3; cardArea.Y = 17; cardArea.W = 21; cardArea.H = 28;
+		CardId ten(CardId::Num10, CardId::Hearts);
+		CardId king(CardId::NumKing, CardId::Spades);
+		begin("background_full");  GameState.drawBackground(screen);               end();
+		begin("background_card");  GameState.drawBackground(cardArea);             end();
+		begin("drawCard");         GameState.drawCard(king, 3, 17);                 end();
+		begin("drawCard_ten");     GameState.drawCard(ten, 25, 17);                 end();
+		begin("drawCard_small");   GameState.drawCard(king, 47, 17, true);          end();
+		begin("drawCardBack");     GameState.drawCardBack(69, 17);                  end();
+		begin("drawCardBack_small"); GameState.drawCardBack(91, 17, true);          end();
+		begin("drawCursor");       GameState.drawCursor(3, 17);                     end();
+		begin("drawGlyph");        drawGlyph(3, 50, 'K', ST7735_BLACK, ST7735_WHITE); end();
+		begin("cursorOutline");    GameState.paintCursorOutline(3, 17);             end();
+
+		Serial.println("\n]}");
+	}
+
+private:
+	const char* mName;
+	bool mFirst;
+	ST7735Stats mStart;
+	unsigned long mStartedAt;
+};
+#endif
+
+
+///////////////////////////////////////////////////////////////////////////////
+// bookkeeping around every input that changes the board
+// The frame for an input is painted a slice per pass of the main loop, and is
+// restarted by any input that comes in before it is complete, so one frame
+// may end up showing several inputs. Each of them gets its latency recorded
+// when the frame is done, the remote is told that of the oldest one.
+static unsigned long sActionAt;
+static unsigned long sFrameAt;
+#ifdef LATENCY_STATS
+//when the inputs folded into the open frame came in, and how many there
+//were. Past FRAME_INPUTS the last slot holds the newest of them
+#define FRAME_INPUTS 8
+static unsigned long sFrameInputs[FRAME_INPUTS];
+static uint8_t sFrameInputN;
+#endif
+
+#ifdef REMOTE
+//the board as it is now, to the host
+static void remoteState(uint32_t latencyUs, uint32_t drawUs) {
+	RemoteStateReport r;
+	r.Hash = GameState.stateHash();
+	r.LatencyUs = latencyUs;
+	r.DrawUs = drawUs;
+	r.DrawArea = GameState.lastDrawArea();
+	const Card* first = GameState.held(r.Held);
+	r.HeldFirst = first ? first->Which.tohash() : -1;
+	r.Flags = (first ? RemoteHolding : 0) | (GameState.won() ? RemoteWon : 0);
+	//the snapshot leaves out the cards in the air
+	if (GameState.snapshot(r.Snapshot) && !first)
+		r.Flags |= RemoteSnapshotValid;
+	remoteSend(r);
+}
+#endif
+
+static void beginAction() {
+	BENCH_MARK(BenchActionBegin);
+	FRAME_STAGE(StageAction);
+}
+static void endAction(unsigned long eventAt, bool cursorOnly = false) {
+	if (!GameState.drawing()) {
+		sActionAt = eventAt;
+		sFrameAt = micros();
+#ifdef LATENCY_STATS
+		sFrameInputN = 0;
+#endif
+	}
+#ifdef LATENCY_STATS
+	if (sFrameInputN != 0xFF) ++sFrameInputN;
+	sFrameInputs[min(sFrameInputN, FRAME_INPUTS) - 1] = eventAt;
+#endif
+	LOG_STATE(GameState.stateHash());
+	GameState.beginFrame(cursorOnly);
+}
+static void frameDone() {
+	BENCH_MARK(BenchActionEnd);
+	FRAME_END(GameState.lastDrawArea());
+#ifdef LATENCY_STATS
+	for (uint8_t i = 0; i < sFrameInputN; ++i)
+		LATENCY_RECORD(sFrameInputs[min(i, FRAME_INPUTS-1)]);
+#endif
+#ifdef REMOTE
+	unsigned long now = micros();
+	remoteState(now - sActionAt, now - sFrameAt);
+#endif
+}
+
+//the stats screen comes up over the board after a win, or when select is
+//held down for STATS_HOLD_MS on a spot where pressing it does nothing. The
+//next input only takes it away again
+#define STATS_HOLD_MS 1000
+static bool sStatsShown, sStatsWanted;
+static bool sSelectHeld;
+static unsigned long sSelectDownAt;
+
+static bool closeStats(unsigned long eventAt) {
+	if (!sStatsShown) return false;
+	sStatsShown = false;
+	beginAction();
+	GameState.invalidate(STATS_X, STATS_Y, STATS_W, STATS_H);
+	endAction(eventAt);
+	return true;
+}
+
+//a snapshot goes to the EEPROM after every move, between frames, once the
+//one before it is written and the cards are put down
+static bool sSaveWanted;
+
+static void saveService() {
+	if (!sSaveWanted || saveBusy() || GameState.holding()) return;
+	uint8_t buf[SAVE_PAYLOAD];
+	if (GameState.snapshot(buf))
+		saveWrite(buf);
+	sSaveWanted = false;
+}
+
+//deal the given number, or a random one. A game given up on counts as a
+//loss, and the new deal paints over the stats screen if it is up
+static void newGame(unsigned long eventAt, bool chosen, uint16_t deal) {
+	if (!GameState.won() && GameState.moves())
+		statsGameOver(GameState.dealNumber(), GameState.moves(), GameState.elapsedSeconds(), false);
+	sStatsShown = false;
+	beginAction();
+	if (chosen)
+		GameState.initialize(deal);
+	else
+		GameState.initialize();
+	LOG_DEAL(GameState.dealNumber());
+	GameState.flip3();
+	endAction(eventAt);
+	sSaveWanted = true;
+}
+
+#ifdef RACE
+//trade progress with the other board between frames, and play its deal when
+//it starts a new game. True if it did, the frame for it is under way
+static bool raceUpdate() {
+	RaceProgressReport mine;
+	mine.Deal = GameState.dealNumber();
+	mine.Foundations = GameState.foundations();
+	mine.Moves = GameState.moves();
+	mine.Seconds = GameState.elapsedSeconds();
+	mine.Won = GameState.won();
+	uint16_t deal;
+	if (raceService(mine, deal)) {
+		idleActivity();
+		newGame(micros(), true, deal);
+		return true;
+	}
+	char cells[HUD_PANEL];
+	racePanel(cells);
+	GameState.setHudPanel(cells);
+	return false;
+}
+#endif
+
+
 ///////////////////////////////////////////////////////////////////////////////
 void setup() {
 	//std::cout << sizeof(Card) << "\n";
+#ifdef TELEMETRY_ENABLED
+	Serial.begin(TELEMETRY_BAUD);
+#else
 	Serial.begin(9600);
+#endif
+	//start sampling early, the display init gives it time to collect entropy
+	inputBegin();
+#ifdef PROFILE
+	profileBegin();
+#endif
+#ifdef RACE
+	raceBegin();
+#endif
+#ifdef FAST_BOOT
+	tft.setWarmStart(warmStart());
+#endif
 	tft.initR(INITR_REDTAB);   // initialize a ST7735R chip, red tab
 	tft.setRotation(1);
+#ifdef SD_SPLASH
+	//a splash off the card while the game gets ready
+	unsigned long splashAt = millis();
+	bool splash = storageBegin(SD_CS) && sdImageDraw(SPLASH_FILE, 0, 0, 160, 128);
+#ifdef FAST_BOOT
+	if (splash)
+		tft.displayOn();
+#endif
+#endif
+	LOG_BEGIN(SD_CS);
+
+#ifdef SPI_BENCH
+	SpiBench bench;
+	bench.run();
+	while (true);
+#endif
 
 	// //
 	// tft.fillScreen(tft.Color565(0,200,0));
@@ -902,51 +2108,121 @@ void setup() {
 	// 	DrawCard(CardId::RandomCard(), 3 + 22*6, 17+8*i);
 	// }
 
-	GameState.initialize();
-	GameState.flip3();
+	BENCH_MARK(BenchBootBegin);
+	//carry on with the game from before the reset, if there was one
+	uint8_t save[SAVE_PAYLOAD];
+	statsLoad();
+	if (!saveLoad(save) || !GameState.restore(save)) {
+		GameState.initialize();
+		GameState.flip3();
+	}
+	LOG_DEAL(GameState.dealNumber());
+#ifdef SD_SPLASH
+	if (splash)
+		while (millis() - splashAt < SPLASH_MS);
+#endif
 	GameState.draw();
-
-	long lastMoveAt = 0;
-	bool lastButtonState = false;
-	int joyBaseY = analogRead(0);
-	int joyBaseX = analogRead(1);
-	pinMode(9, INPUT_PULLUP);
-	pinMode(14, INPUT_PULLUP);
+#ifdef FAST_BOOT
+	//the first frame went out while the panel was still settling after
+	//SLPOUT, it shows up all at once when the display comes on
+	tft.displayOn();
+	sBootMagic = BOOT_MAGIC;
+#endif
+	BENCH_MARK(BenchBootEnd);
+
+	JoystickRepeat joystick;
 	//
 	while (true) {
-		long now = millis();
-		if (now-lastMoveAt > 400) {
-			int dy = -(analogRead(0)-joyBaseY);
-			int dx = analogRead(1)-joyBaseX;
-			if (abs(dy) > 35) {
-				dy = (dy>0) ? 1 : -1;
-			} else {
-				dy = 0;
+		//a frame is open from the first input until its painting is complete
+		if (GameState.drawing())
+			FRAME_STAGE(StageInput);
+		else
+			FRAME_BEGIN();
+		TELEMETRY_POLL();
+#ifdef REMOTE
+		if (remotePoll())
+			remoteState(0, 0);
+#endif
+		InputEvent e;
+		while (inputPoll(e)) {
+			idleActivity();
+			LOG_INPUT(e);
+			switch (e.Type) {
+			case InputJoystick:
+				//every deflection from rest moves once right away, even if the
+				//stick is back at rest by the time we get to the event
+				if (joystick.onEvent(e) && !closeStats(e.At)) {
+					beginAction();
+					GameState.moveCursor(joystick.dx(), joystick.dy());
+					endAction(e.At, true);
+				}
+				break;
+			case InputSelectDown: {
+				if (closeStats(e.At))
+					break;
+				uint16_t moves = GameState.moves();
+				bool won = GameState.won();
+				bool holding = GameState.holding();
+				beginAction();
+				GameState.button1Down();
+				endAction(e.At);
+				//only a press that did nothing can be held for the stats, one
+				//that picked up, put down or turned cards is part of play
+				sSelectHeld = !holding && !GameState.holding() && GameState.moves() == moves;
+				sSelectDownAt = millis();
+				sSaveWanted |= (GameState.moves() != moves);
+				if (GameState.won() && !won) {
+					statsGameOver(GameState.dealNumber(), GameState.moves(), GameState.elapsedSeconds(), true);
+					sStatsWanted = true;
+				}
+				break;
 			}
-			if (abs(dx) > 35) {
-				dx = (dx>0) ? 1 : -1;
-			} else {
-				dx = 0;
-			}
-			if (dx!=0 || dy!=0) {
-				//do move
-				lastMoveAt = now;
-				GameState.moveCursor(dx, dy);
-				GameState.draw();
-			}
-		}
-		if (!lastButtonState && !digitalRead(9)) {
-			lastButtonState = true;
-			GameState.button1Down();
-			GameState.draw();
-		} else if (lastButtonState && digitalRead(9)) {
-			lastButtonState = false;
-		}
-		if (!digitalRead(14)) {
-			delay(500);
-			GameState.initialize();
-			GameState.flip3();
-			GameState.draw();
+			case InputSelectUp:
+				sSelectHeld = false;
+				break;
+			case InputResetDown:
+				newGame(e.At, false, 0);
+#ifdef RACE
+				raceStart(GameState.dealNumber());
+#endif
+				break;
+			}
+		}
+		//a held stick repeats, faster the longer it is held
+		unsigned long dueAt;
+		if (joystick.poll(micros(), dueAt) && !closeStats(dueAt)) {
+			idleActivity();
+			beginAction();
+			GameState.moveCursor(joystick.dx(), joystick.dy());
+			endAction(dueAt, true);
+		}
+		//then paint the next slice of the frame, if there is one, or of a card
+		//slide. If there is neither, it is time to write the log and the snapshot
+		//out, and to wait for the next interrupt
+		if (GameState.drawing()) {
+			if (GameState.drawStep())
+				frameDone();
+		} else if (!GameState.animStep()) {
+#ifdef RACE
+			if (raceUpdate())
+				continue;
+#endif
+			GameState.tickHud();
+			if (sSelectHeld && millis() - sSelectDownAt >= STATS_HOLD_MS) {
+				sSelectHeld = false;
+				sStatsWanted = !sStatsShown;
+			}
+			if (sStatsWanted) {
+				statsDraw();
+				sStatsShown = true;
+				sStatsWanted = false;
+			}
+			LOG_SERVICE();
+			statsService();
+			saveService();
+			unsigned long wakeAt = micros() + IDLE_POLL_MS*1000UL;
+			joystick.nextDue(wakeAt);
+			idleWait(wakeAt);
 		}
 	}
 }
@@ -0,0 +1,70 @@
+//
+#include "Sram.h"
+#include "Telemetry.h"
+
+#ifdef SRAM_STATS
+
+//from the linker script and avr-libc's malloc
+extern uint8_t __data_start, __data_end, __bss_start, _end, __heap_start;
+extern uint8_t* __brkval;
+struct __freelist {
+	size_t sz;
+	struct __freelist* nx;
+};
+extern struct __freelist* __flp;
+
+//runs from .init3, after the stack pointer is set and before anything has
+//been pushed, so it can't use the stack. Paints _end up to RAMEND
+extern "C" void sramPaint() __attribute__((naked, used, section(".init3")));
+void sramPaint() {
+	asm volatile(
+		"ldi r30, lo8(_end)\n\t"
+		"ldi r31, hi8(_end)\n\t"
+		"ldi r24, %0\n\t"
+		"ldi r25, hi8(%1)\n\t"
+		"rjmp 2f\n"
+		"1:\n\t"
+		"st Z+, r24\n"
+		"2:\n\t"
+		"cpi r30, lo8(%1)\n\t"
+		"cpc r31, r25\n\t"
+		"brlo 1b\n\t"
+		"breq 1b\n\t"
+		:: "i" (SRAM_CANARY), "i" (RAMEND) : "memory");
+}
+
+void sramReport(SramReport& r) {
+	uint8_t* brk = __brkval ? __brkval : &__heap_start;
+	r.Ram = RAMEND + 1 - RAMSTART;
+	r.Data = &__data_end - &__data_start;
+	r.Bss = &_end - &__bss_start;
+	r.Heap = brk - &__heap_start;
+
+	uint8_t oldSREG = SREG;
+	cli();
+	r.HeapFree = 0;
+	r.HeapLargest = 0;
+	r.HeapBlocks = 0;
+	for (struct __freelist* f = __flp; f; f = f->nx) {
+		//the size word is part of the block, as malloc counts it
+		r.HeapFree += f->sz + sizeof(size_t);
+		r.HeapLargest = max(r.HeapLargest, f->sz);
+		if (r.HeapBlocks != 0xFF) ++r.HeapBlocks;
+	}
+	SREG = oldSREG;
+
+	uint8_t* p = brk;
+	while (p <= (uint8_t*)RAMEND && *p == SRAM_CANARY)
+		++p;
+	r.Untouched = p - brk;
+	r.StackMax = (uint8_t*)RAMEND + 1 - p;
+	r.StackNow = RAMEND - SP;
+}
+
+void sramDump() {
+	SramReport r;
+	sramReport(r);
+	telemetrySend(TelemetrySram, &r, sizeof(r));
+}
+
+#endif
@@ -0,0 +1,45 @@
+//
+// SRAM use: statics, heap and the deepest the stack has been, compiled in
+// with SRAM_STATS.
+//
+// Before the constructors run, everything from the end of the statics up to
+// RAMEND is painted with SRAM_CANARY. The heap grows up into that and the
+// stack down, so the canary bytes left between the top of the heap and the
+// lowest byte the stack ever wrote say how close the two have come. A stack
+// byte that happens to equal the canary, or heap freed off the top, makes it
+// err on the high side.
+//
+// Sending SRAM_DUMP_REQUEST over Serial answers with a TelemetrySram
+// frame: the .data and .bss sizes, the heap and its free list, the stack now
+// and at its deepest, and the bytes never touched. tools/sram.py prints it
+// along with the statics of each source file, from the ELF. Under simbench,
+// -m asks for one at the end of the run.
+//
+#ifndef _SRAM_H_
+#define _SRAM_H_
+
+#include "Arduino.h"
+
+#define SRAM_CANARY       0xC5
+#define SRAM_DUMP_REQUEST 'M'
+
+//payload of a TelemetrySram frame, in bytes
+struct SramReport {
+	uint16_t Ram;         //all of the SRAM
+	uint16_t Data;        //initialized statics
+	uint16_t Bss;         //zeroed and .noinit statics
+	uint16_t Heap;        //from the start of the heap to the break
+	uint16_t HeapFree;    //in the free list, below the break
+	uint16_t HeapLargest; //the largest free block
+	uint8_t HeapBlocks;   //blocks in the free list
+	uint16_t StackNow;
+	uint16_t StackMax;    //the deepest since boot
+	uint16_t Untouched;   //between the break and StackMax, never written
+};
+
+#ifdef SRAM_STATS
+void sramReport(SramReport& report);
+void sramDump();
+#endif
+
+#endif
@@ -0,0 +1,169 @@
+//
+#include "Stats.h"
+#include "Eeprom.h"
+#include "Mod_Adafruit_ST7735.h"
+#include <avr/eeprom.h>
+#include <util/crc16.h>
+
+extern Adafruit_ST7735 tft;
+
+static StatsRecord sStats;   //the record as it is now
+static StatsRecord sWriting; //the copy Eeprom is writing out
+static uint8_t sCopy;        //which of the two was written last
+static bool sChanged;
+
+static uint16_t statsCrc(const StatsRecord& r) {
+	const uint8_t* p = (const uint8_t*)&r;
+	uint16_t crc = 0xFFFF;
+	for (uint8_t i = 0; i < sizeof(StatsRecord) - 2; ++i)
+		crc = _crc16_update(crc, p[i]);
+	return crc;
+}
+
+static uint16_t copyAddr(uint8_t copy) {
+	return STATS_EEPROM_BASE + copy*sizeof(StatsRecord);
+}
+
+static bool readCopy(uint8_t copy, StatsRecord& r) {
+	eeprom_read_block(&r, (const void*)copyAddr(copy), sizeof(r));
+	return r.Version == STATS_VERSION && r.Crc == statsCrc(r);
+}
+
+void statsLoad() {
+	StatsRecord other;
+	bool first = readCopy(0, sStats), second = readCopy(1, other);
+	if (second && (!first || (int8_t)(other.Seq - sStats.Seq) > 0)) {
+		sStats = other;
+		sCopy = 1;
+	} else if (first) {
+		sCopy = 0;
+	} else {
+		memset(&sStats, 0, sizeof(sStats));
+		sStats.Version = STATS_VERSION;
+		sStats.FastestWin = 0xFFFF;
+		sStats.FewestMoves = 0xFFFF;
+		sCopy = 1;
+	}
+}
+
+void statsGameOver(uint16_t deal, uint16_t moves, uint16_t seconds, bool won) {
+	StatsRecord& s = sStats;
+	if (s.Played != 0xFFFF) ++s.Played;
+	if (won) {
+		if (s.Won != 0xFFFF) ++s.Won;
+		s.FastestWin = min(s.FastestWin, seconds);
+		s.FewestMoves = min(s.FewestMoves, moves);
+		if (s.Streak != 0xFFFF) ++s.Streak;
+		s.BestStreak = max(s.BestStreak, s.Streak);
+	} else {
+		s.Streak = 0;
+	}
+	StatsGame& g = s.Recent[s.Next];
+	g.Deal = deal;
+	g.Moves = moves;
+	g.Seconds = min(seconds, StatsWonBit - 1) | (won ? StatsWonBit : 0);
+	s.Next = (s.Next + 1) % STATS_RECENT;
+	sChanged = true;
+}
+
+void statsService() {
+	if (!sChanged || eepromBusy()) return;
+	++sStats.Seq;
+	sWriting = sStats;
+	sWriting.Crc = statsCrc(sWriting);
+	//over the older copy, so the newer one is still good if this one is cut short
+	uint8_t copy = sCopy ^ 1;
+	if (eepromWrite(copyAddr(copy), (const uint8_t*)&sWriting, sizeof(sWriting))) {
+		sCopy = copy;
+		sChanged = false;
+	}
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// the screen
+
+//minutes and seconds, right aligned in 6 cells, or a dash for none
+static void putTime(char* c, uint16_t seconds, bool none) {
+	if (none) {
+		c[5] = '-';
+		return;
+	}
+	putNumber(c, min(seconds/60, 999), 3);
+	c[3] = ':';
+	c[4] = '0' + (seconds%60)/10;
+	c[5] = '0' + seconds%10;
+}
+
+static void putText(char* c, const char* text) {
+	while (*text)
+		*c++ = *text++;
+}
+
+//the characters of one row of the screen
+static void statsLine(uint8_t row, char* c) {
+	const StatsRecord& s = sStats;
+	memset(c, ' ', STATS_COLS);
+	switch (row) {
+	case 0:
+		putText(c + 7, "STATS");
+		break;
+	case 2:
+		putText(c, "PLAYED");
+		putNumber(c + 14, s.Played, 6);
+		break;
+	case 3:
+		putText(c, "WON");
+		putNumber(c + 4, s.Won, 5);
+		if (s.Played) {
+			putNumber(c + 16, (uint32_t)s.Won*100 / s.Played, 3);
+			c[19] = '%';
+		}
+		break;
+	case 4:
+		putText(c, "FASTEST");
+		putTime(c + 14, s.FastestWin, s.FastestWin == 0xFFFF);
+		break;
+	case 5:
+		putText(c, "FEWEST MOVES");
+		if (s.FewestMoves == 0xFFFF)
+			c[19] = '-';
+		else
+			putNumber(c + 15, s.FewestMoves, 5);
+		break;
+	case 6:
+		putText(c, "STREAK");
+		putNumber(c + 6, s.Streak, 4);
+		putText(c + 12, "BEST");
+		putNumber(c + 16, s.BestStreak, 4);
+		break;
+	case 8:
+		putText(c, "DEAL   W MOVES  TIME");
+		break;
+	default:
+		if (row > 8 && row - 9 < STATS_RECENT) {
+			//newest first, slots that were never used stay blank
+			const StatsGame& g = s.Recent[(s.Next + STATS_RECENT*2 - 1 - (row - 9)) % STATS_RECENT];
+			if (!g.Moves && !g.Seconds) break;
+			bool won = g.Seconds & StatsWonBit;
+			putNumber(c, g.Deal, 5);
+			c[7] = won ? 'W' : '-';
+			putNumber(c + 9, g.Moves, 5);
+			putTime(c + 14, g.Seconds & ~StatsWonBit, false);
+		}
+		break;
+	}
+}
+
+void statsDraw() {
+	uint16_t color = ST7735_WHITE, bg = tft.Color565(0, 40, 0);
+	tft.fillRect(STATS_X, STATS_Y, STATS_W, STATS_H, bg);
+	tft.drawRect(STATS_X, STATS_Y, STATS_W, STATS_H, color);
+	char line[STATS_COLS];
+	for (uint8_t row = 0; row < STATS_ROWS; ++row) {
+		statsLine(row, line);
+		for (uint8_t i = 0; i < STATS_COLS; ++i)
+			if (line[i] != ' ')
+				drawGlyph(STATS_X + 2 + i*GLYPH_W, STATS_Y + 2 + row*GLYPH_H, line[i], color, bg);
+	}
+}
@@ -0,0 +1,70 @@
+//
+// Lifetime statistics in EEPROM, and the screen that shows them.
+//
+// Games played and won, the fastest win, the fewest moves in a win, the
+// current and best run of wins, and the deal, moves and time of the last
+// STATS_RECENT games are kept in one StatsRecord with a version and a
+// CRC-16. The record is kept in two copies that are written in turn, each
+// with a sequence number, so one that was only partly written when the
+// power went fails its CRC and the other one is used.
+//
+// statsGameOver() only updates the record in SRAM, so the end of a game and
+// the new game button don't wait on the EEPROM. statsService(), called
+// between frames, hands the record to Eeprom once nothing else is being
+// written, and Eeprom programs only the bytes that changed.
+//
+// statsDraw() paints the stats screen over the middle of the board with
+// the glyph cells, skipping the blank ones.
+//
+#ifndef _STATS_H_
+#define _STATS_H_
+
+#include "Arduino.h"
+#include "Save.h"
+#include "Glyphs.h"
+
+#define STATS_EEPROM_BASE SAVE_EEPROM_END //the two copies go after the save slots
+#define STATS_VERSION     1
+#define STATS_RECENT      5
+
+#define STATS_COLS  20
+#define STATS_ROWS  14
+#define STATS_W     (STATS_COLS*GLYPH_W + 4)
+#define STATS_H     (STATS_ROWS*GLYPH_H + 4)
+#define STATS_X     ((160 - STATS_W)/2)
+#define STATS_Y     2
+
+struct StatsGame {
+	uint16_t Deal;
+	uint16_t Moves;
+	uint16_t Seconds; //StatsWonBit set for a win
+};
+#define StatsWonBit 0x8000
+
+struct StatsRecord {
+	uint8_t Seq;
+	uint8_t Version;
+	uint16_t Played;
+	uint16_t Won;
+	uint16_t FastestWin;  //seconds, 0xFFFF before the first win
+	uint16_t FewestMoves; //in a win, 0xFFFF before the first win
+	uint16_t Streak;      //wins in a row, up to the last game
+	uint16_t BestStreak;
+	uint8_t Next;         //the slot of Recent the next game goes in
+	StatsGame Recent[STATS_RECENT];
+	uint16_t Crc;
+};
+
+//read the newer good copy, or start from nothing
+void statsLoad();
+
+//a game was won, or left for a new deal
+void statsGameOver(uint16_t deal, uint16_t moves, uint16_t seconds, bool won);
+
+//write the record out if it changed and the EEPROM is free
+void statsService();
+
+//paint the stats screen, at STATS_X, STATS_Y
+void statsDraw();
+
+#endif
@@ -0,0 +1,44 @@
+//
+#include "Storage.h"
+
+#ifdef STORAGE_ENABLED
+
+Sd2Card storageCard;
+SdFile storageRoot;
+uint8_t storageBuffer[512];
+static SdVolume sVolume;
+static uint8_t sCsPin;
+static uint8_t sState; //0 not tried yet, 1 working, 2 failed
+
+bool storageBegin(uint8_t csPin) {
+	if (sState == 0) {
+		StorageBus bus;
+		sCsPin = csPin;
+		bool ok = storageCard.init(SPI_FULL_SPEED, csPin) && sVolume.init(&storageCard) &&
+			storageRoot.openRoot(&sVolume);
+		sState = ok ? 1 : 2;
+	}
+	return sState == 1;
+}
+
+bool storageBusy() {
+	digitalWrite(sCsPin, LOW);
+	SPDR = 0xFF;
+	while (!(SPSR & _BV(SPIF)));
+	bool busy = (SPDR != 0xFF);
+	digitalWrite(sCsPin, HIGH);
+	return busy;
+}
+
+bool storageFind(const char* name, uint32_t& firstBlock, uint32_t& size) {
+	SdFile file;
+	uint32_t lastBlock;
+	if (!file.open(&storageRoot, name, O_READ))
+		return false;
+	size = file.fileSize();
+	bool contiguous = file.contiguousRange(&firstBlock, &lastBlock);
+	file.close();
+	return contiguous;
+}
+
+#endif
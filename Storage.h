@@ -0,0 +1,59 @@
+//
+// The SD card, shared by the event log and the images streamed from it.
+//
+// storageBegin() brings up the card and its FAT volume the first time it is
+// called, and after that only says whether that worked. Files are used a
+// whole 512 byte sector at a time straight through storageCard, not through
+// File, so they have to be contiguous on the card.
+//
+// The card shares the SPI bus with the display. The display driver releases
+// its chip select after every primitive, so the card can be used between
+// any two of them without more arbitration between SD_CS and TFT_CS. The
+// card library sets SPCR/SPSR for its own rate though, so every use of the
+// card goes inside a StorageBus guard, which puts back what the driver set.
+// The guard should only be around the card calls, so the display's own
+// primitives keep running at its rate.
+//
+// storageBuffer is the one sector buffer for whoever has the card: the
+// images at boot, then the event log's block once logBegin() has run.
+//
+#ifndef _STORAGE_H_
+#define _STORAGE_H_
+
+#include "Arduino.h"
+
+//builds that use the card at all
+#if defined(SD_LOG) || defined(SD_SPLASH)
+#define STORAGE_ENABLED
+#endif
+
+#ifdef STORAGE_ENABLED
+#include <SD.h>
+
+extern Sd2Card storageCard;
+extern SdFile storageRoot;
+extern uint8_t storageBuffer[512];
+
+//false if there is no card, or no FAT volume on it
+bool storageBegin(uint8_t csPin);
+
+//the card holds MISO low while it is still programming a written block
+bool storageBusy();
+
+//first block and size in bytes of a file, false if it is missing or isn't
+//contiguous
+bool storageFind(const char* name, uint32_t& firstBlock, uint32_t& size);
+
+class StorageBus {
+public:
+	StorageBus(): mSpcr(SPCR), mSpsr(SPSR) {}
+	~StorageBus() {
+		SPCR = mSpcr;
+		SPSR = mSpsr;
+	}
+private:
+	uint8_t mSpcr, mSpsr;
+};
+#endif
+
+#endif
@@ -0,0 +1,55 @@
+//
+#include "Telemetry.h"
+#include "Latency.h"
+#include "Profile.h"
+#include "Sram.h"
+#include <util/crc16.h>
+
+void telemetrySend(uint8_t type, const void* payload, uint8_t len) {
+	telemetrySend(Serial, type, payload, len);
+}
+
+void telemetrySend(Print& out, uint8_t type, const void* payload, uint8_t len) {
+	const uint8_t* p = (const uint8_t*)payload;
+	uint8_t crc = 0;
+	out.write((uint8_t)TELEMETRY_SYNC);
+	out.write(type);
+	crc = _crc_ibutton_update(crc, type);
+	out.write(len);
+	crc = _crc_ibutton_update(crc, len);
+	for (uint8_t i = 0; i < len; ++i) {
+		out.write(p[i]);
+		crc = _crc_ibutton_update(crc, p[i]);
+	}
+	out.write(crc);
+}
+
+void telemetryRequest(uint8_t b) {
+	switch (b) {
+#ifdef LATENCY_STATS
+	case LATENCY_DUMP_REQUEST:
+		latencyDump();
+		break;
+#endif
+#ifdef PROFILE
+	case PROFILE_DUMP_REQUEST:
+		profileDump();
+		break;
+	case PROFILE_RESET_REQUEST:
+		profileReset();
+		break;
+#endif
+#ifdef SRAM_STATS
+	case SRAM_DUMP_REQUEST:
+		sramDump();
+		break;
+#endif
+	}
+}
+
+#if defined(TELEMETRY_REQUESTS) && !defined(REMOTE)
+void telemetryPoll() {
+	while (Serial.available())
+		telemetryRequest(Serial.read());
+}
+#endif
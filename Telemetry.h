@@ -0,0 +1,60 @@
+//
+// Framing for the binary data the firmware streams over Serial.
+//
+// Every frame is:
+//     TELEMETRY_SYNC, type, length, payload[length], crc8
+// where the crc is the Dallas/iButton CRC-8 over type, length and payload.
+// Multi-byte values in payloads are little endian, as the AVR stores them.
+// tools/telemetry.py decodes the stream on the host side. REMOTE builds also
+// take frames the other way, from the host, see Remote.h, and RACE builds
+// send the same frames to each other on Serial1, see Race.h.
+//
+#ifndef _TELEMETRY_H_
+#define _TELEMETRY_H_
+
+#include "Arduino.h"
+
+#define TELEMETRY_SYNC 0xA5
+#define TELEMETRY_BAUD 500000 //exact at 16MHz with U2X
+
+//builds that stream anything switch Serial to TELEMETRY_BAUD
+//and the ones that answer one byte requests from the host read them
+#if defined(LATENCY_STATS) || defined(PROFILE) || defined(SRAM_STATS)
+#define TELEMETRY_REQUESTS
+#endif
+#if defined(FRAME_TIMING) || defined(TELEMETRY_REQUESTS) || defined(REMOTE)
+#define TELEMETRY_ENABLED
+#endif
+
+enum TelemetryType {
+	TelemetryFrameTiming = 1, //FrameTimingReport
+	TelemetryLatency     = 2, //LatencyReport
+	TelemetryState       = 3, //RemoteStateReport
+	TelemetryProfile     = 4, //ProfileReport
+	TelemetrySram        = 5, //SramReport
+	//host to device
+	RemoteInput          = 0x40, //RemoteInputCommand
+	RemoteStateRequest   = 0x41, //no payload, answered with a TelemetryState
+	//board to board
+	RaceStart            = 0x60, //RaceStartCommand
+	RaceProgress         = 0x61, //RaceProgressReport
+};
+
+//queue one frame on Serial, only blocks if the transmit buffer is full
+void telemetrySend(uint8_t type, const void* payload, uint8_t len);
+//or on another port
+void telemetrySend(Print& out, uint8_t type, const void* payload, uint8_t len);
+
+//answer a one byte request from the host, LATENCY_DUMP_REQUEST,
+//SRAM_DUMP_REQUEST or the PROFILE_ ones, in the builds that have them
+void telemetryRequest(uint8_t b);
+
+#if defined(TELEMETRY_REQUESTS) && !defined(REMOTE)
+//take the requests off Serial, REMOTE builds pass them on from remotePoll()
+void telemetryPoll();
+#define TELEMETRY_POLL() telemetryPoll()
+#else
+#define TELEMETRY_POLL()
+#endif
+
+#endif
@@ -0,0 +1,109 @@
+#!/usr/bin/env python3
+"""Decode an EVENTSn.LOG an SD_LOG build writes to the SD card.
+
+    tools/eventlog.py /media/sd/EVENTS2.LOG
+    tools/eventlog.py -t /media/sd/EVENTS2.LOG > session.trace
+
+The file is a run of 512 byte blocks of 8 byte records, described in
+EventLog.h. The file is preallocated, so it ends at the first block that
+doesn't start with a header for the next block number.
+
+With -t the inputs are written as a trace for simbench -r instead, starting
+at the first deal. Every deal starts a new session, the trace takes the
+first one only unless -a is given too.
+"""
+import struct
+import sys
+
+BLOCK = 512
+RECORD = struct.Struct('<BBHI')
+
+LOG_PADDING = 0
+LOG_INPUT = 1
+LOG_DEAL = 2
+LOG_STATE = 3
+LOG_BLOCK = 0xB1
+
+INPUTS = ['joystick', 'select down', 'select up', 'reset down']
+
+
+def signed8(b):
+    return b - 256 if b & 0x80 else b
+
+
+def records(data):
+    """Yield (type, arg, value, at) for every record of every valid block."""
+    for n in range(len(data) // BLOCK):
+        block = data[n * BLOCK:(n + 1) * BLOCK]
+        kind, lost, number, at = RECORD.unpack_from(block, 0)
+        if kind != LOG_BLOCK or number != n & 0xFFFF:
+            return
+        if lost:
+            print('-- %d records lost before block %d' % (lost, n))
+        for off in range(RECORD.size, BLOCK, RECORD.size):
+            record = RECORD.unpack_from(block, off)
+            if record[0] != LOG_PADDING:
+                yield record
+
+
+def write_trace(data, all_deals):
+    """Inputs as simbench -r trace lines, milliseconds from the first deal."""
+    start = None
+    pending_reset = None
+    for kind, arg, value, at in records(data):
+        if kind == LOG_DEAL:
+            if start is None:
+                start = at
+                print('deal %d' % value)
+            elif pending_reset is not None:
+                if not all_deals:
+                    return
+                print('%.3f reset %d' % (pending_reset, value))
+            pending_reset = None
+            continue
+        if kind != LOG_INPUT or start is None:
+            continue
+        t = ((at - start) & 0xFFFFFFFF) / 1000.0
+        if arg == 0:
+            print('%.3f stick %d %d' % (t, signed8(value >> 8), signed8(value & 0xFF)))
+        elif arg == 1:
+            print('%.3f select down' % t)
+        elif arg == 2:
+            print('%.3f select up' % t)
+        elif arg == 3:
+            # the new deal's number comes in the record after it
+            pending_reset = t
+
+
+def main():
+    args = sys.argv[1:]
+    trace = '-t' in args
+    all_deals = '-a' in args
+    args = [a for a in args if a not in ('-t', '-a')]
+    if len(args) != 1:
+        sys.exit(__doc__)
+    with open(args[0], 'rb') as f:
+        data = f.read()
+    if trace:
+        write_trace(data, all_deals)
+        return
+    start = None
+    for kind, arg, value, at in records(data):
+        if start is None:
+            start = at
+        t = ((at - start) & 0xFFFFFFFF) / 1e6
+        if kind == LOG_INPUT:
+            name = INPUTS[arg] if arg < len(INPUTS) else 'input %d' % arg
+            if arg == 0:
+                name += ' %+d %+d' % (signed8(value >> 8), signed8(value & 0xFF))
+            print('%10.3f  %s' % (t, name))
+        elif kind == LOG_DEAL:
+            print('%10.3f  deal %d' % (t, value))
+        elif kind == LOG_STATE:
+            print('%10.3f  state %04x' % (t, value))
+        else:
+            print('%10.3f  unknown record %d' % (t, kind))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,164 @@
+#!/usr/bin/env python3
+"""Print where a PROFILE build of the firmware spends its time.
+
+    tools/fwprofile.py Solitaire.elf /dev/ttyACM0        # clear, wait 10 s, dump
+    tools/fwprofile.py -t 30 Solitaire.elf /dev/ttyACM0  # wait 30 s instead
+    tools/fwprofile.py Solitaire.elf uart.bin            # simbench -p -u capture
+
+The bins of the sampling profiler (Profile.h) are split between the functions
+of the ELF's symbol table, read with avr-nm (-n picks another nm), in
+proportion to how many bytes of the bin each function covers. Bins are
+2^Shift bytes, so a small function sharing a bin with a big one gets only an
+estimate. Functions are printed with their share of the samples, then the
+same totals rolled up into a few groups of the game (spi, gfx, draw, ...).
+With a port, the profile is cleared first so it covers the wait alone.
+"""
+import bisect
+import struct
+import subprocess
+import sys
+import time
+
+from telemetry import frames, open_stream
+
+TYPE_PROFILE = 4
+
+PROFILE_DUMP_REQUEST = b'P'
+PROFILE_RESET_REQUEST = b'p'
+PROFILE_FORMAT = '<IIHHBB32H'
+
+# first match wins, on the demangled name
+GROUPS = [
+    ('profiler', ('__vector_profile', 'profile')),
+    ('spi', ('spiwrite', 'SPIClass', 'writecommand', 'writedata', 'pushColor')),
+    ('display', ('Adafruit_ST7735',)),
+    ('gfx', ('Adafruit_GFX', 'drawGlyph', 'glyphColumn')),
+    ('draw', ('BoardState::draw', 'BoardState::paint', 'BoardState::anim',
+              'Draw', 'Hud::')),
+    ('idle', ('idleWait',)),
+    ('input', ('Input', 'input', 'Joystick', '__vector_')),
+    ('game', ('BoardState', 'Deck', 'Card')),
+    ('telemetry', ('telemetry', 'HardwareSerial', 'Print::', 'latency',
+                   'remote', 'race')),
+    ('storage', ('SdFile', 'Sd2Card', 'SdVolume', 'File', 'eeprom', 'save',
+                 'stats', 'log', 'storage')),
+    ('runtime', ('__', 'mem', 'malloc', 'free')),
+]
+
+
+def symbols(elf, nm):
+    """Sorted (address, size, name) of the functions in the ELF."""
+    out = subprocess.run([nm, '-C', '-S', '-n', '--defined-only', elf],
+                         check=True, capture_output=True, text=True).stdout
+    syms = []
+    for line in out.splitlines():
+        parts = line.split(None, 3)
+        if len(parts) == 4 and parts[2] in 'tTwW':
+            syms.append((int(parts[0], 16), int(parts[1], 16), parts[3]))
+    return syms
+
+
+def read_profile(stream):
+    """The bins of the last dump in the stream, and its header."""
+    bins, head = {}, None
+    for kind, payload in frames(stream):
+        if kind != TYPE_PROFILE:
+            continue
+        fields = struct.unpack(PROFILE_FORMAT, payload)
+        base, samples, outside, first, shift, halved = fields[:6]
+        if head and head[4] != halved:
+            print('fwprofile.py: counts were halved during the dump, '
+                  'the bins are off by a factor', file=sys.stderr)
+        head = (base, samples, outside, shift, halved)
+        for i, n in enumerate(fields[6:]):
+            bins[first + i] = n
+    return head, bins
+
+
+def attribute(head, bins, syms):
+    """Samples per function, from the bins."""
+    base, _, outside, shift, _ = head
+    starts = [s[0] for s in syms]
+    per = {}
+    for b, n in bins.items():
+        if not n:
+            continue
+        lo = base + (b << shift)
+        hi = lo + (1 << shift)
+        i = max(0, bisect.bisect_right(starts, lo) - 1)
+        covered = 0
+        shares = []
+        while i < len(syms) and syms[i][0] < hi:
+            a, size, name = syms[i]
+            overlap = min(hi, a + max(size, 2)) - max(lo, a)
+            if overlap > 0:
+                shares.append((name, overlap))
+                covered += overlap
+            i += 1
+        if not covered:
+            per['(unknown)'] = per.get('(unknown)', 0) + n
+            continue
+        for name, overlap in shares:
+            per[name] = per.get(name, 0) + n * overlap / covered
+    if outside:
+        per['(outside the bins)'] = outside
+    return per
+
+
+def group_of(name):
+    for group, needles in GROUPS:
+        if any(needle in name for needle in needles):
+            return group
+    return 'other'
+
+
+def report(head, per):
+    base, samples, _, shift, halved = head
+    total = sum(per.values()) or 1
+    print('%d samples, %d byte bins from 0x%x%s' % (
+        samples, 1 << shift, base,
+        ', counts halved %d times' % halved if halved else ''))
+    print('%7s  %s' % ('%', 'function'))
+    for name, n in sorted(per.items(), key=lambda kv: -kv[1]):
+        share = 100.0 * n / total
+        if share < 0.1:
+            break
+        print('%6.1f%%  %s' % (share, name))
+    groups = {}
+    for name, n in per.items():
+        groups[group_of(name)] = groups.get(group_of(name), 0) + n
+    print()
+    for group, n in sorted(groups.items(), key=lambda kv: -kv[1]):
+        print('%6.1f%%  %s' % (100.0 * n / total, group))
+
+
+def main():
+    args = sys.argv[1:]
+    wait, nm = 10.0, 'avr-nm'
+    while args and args[0] in ('-t', '-n') and len(args) > 1:
+        if args[0] == '-t':
+            wait = float(args[1])
+        else:
+            nm = args[1]
+        args = args[2:]
+    if len(args) != 2:
+        sys.exit(__doc__)
+    syms = symbols(args[0], nm)
+    stream = open_stream(args[1])
+    if args[1].startswith('/dev/'):
+        stream.write(PROFILE_RESET_REQUEST)
+        try:
+            time.sleep(wait)
+        except KeyboardInterrupt:
+            pass
+        stream.reset_input_buffer()
+        stream.write(PROFILE_DUMP_REQUEST)
+    # a port stops giving frames once it has been quiet for its timeout
+    head, bins = read_profile(stream)
+    if not head:
+        sys.exit('fwprofile.py: no profile in %s, is it a PROFILE build?' % args[1])
+    report(head, attribute(head, bins, syms))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,54 @@
+#!/usr/bin/env python3
+"""Convert an image to the raw form SdImage.h streams off the SD card.
+
+    tools/mkimage.py splash.png SPLASH.IMG           # RGB565, 2 bytes a pixel
+    tools/mkimage.py -12 splash.png SPLASH.IMG       # 4-4-4, 1.5 bytes a pixel
+
+The image is scaled to 160x128 (the screen, in the game's rotation) unless
+-s WxH says otherwise. Needs Pillow. Copy the file to a freshly formatted
+card so that it ends up contiguous.
+"""
+import sys
+
+from PIL import Image
+
+
+def rgb565(pixels):
+    out = bytearray()
+    for r, g, b in pixels:
+        v = ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3)
+        out += bytes((v >> 8, v & 0xFF))
+    return out
+
+
+def rgb444(pixels):
+    out = bytearray()
+    for i in range(0, len(pixels), 2):
+        r1, g1, b1 = (c >> 4 for c in pixels[i])
+        r2, g2, b2 = (c >> 4 for c in pixels[i + 1])
+        out += bytes(((r1 << 4) | g1, (b1 << 4) | r2, (g2 << 4) | b2))
+    return out
+
+
+def main():
+    args = sys.argv[1:]
+    packed = '-12' in args
+    if packed:
+        args.remove('-12')
+    size = (160, 128)
+    if '-s' in args:
+        i = args.index('-s')
+        size = tuple(int(v) for v in args[i + 1].split('x'))
+        del args[i:i + 2]
+    if len(args) != 2:
+        sys.exit(__doc__)
+    if packed and size[0] * size[1] % 2:
+        sys.exit('12 bit images need an even number of pixels')
+    image = Image.open(args[0]).convert('RGB').resize(size)
+    pixels = list(image.getdata())
+    with open(args[1], 'wb') as f:
+        f.write(rgb444(pixels) if packed else rgb565(pixels))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,250 @@
+#!/usr/bin/env python3
+"""Drive and mirror a REMOTE build of the firmware over Serial.
+
+    tools/remote.py /dev/ttyACM0 watch            # print the board after every move
+    tools/remote.py /dev/ttyACM0 state            # print the board now
+    tools/remote.py /dev/ttyACM0 send right down press ...
+
+send takes the same steps as a simbench script (left, right, up, down,
+press, reset) and prints the state hash and the timings of every one, one
+line each, so a test rig can compare runs. The port can also be the pty of
+tools/simbench -P. Frames are described in Telemetry.h and Remote.h. Needs
+pyserial.
+
+The board is rebuilt from the packed snapshot with the deal replayed the way
+the firmware shuffles it (avr-libc's rand()), which names the cards in the
+stock and the waste. Face down cards in the columns are printed as ##.
+"""
+import struct
+import sys
+import time
+
+from telemetry import BAUD, SYNC, crc8
+
+TYPE_STATE = 3
+TYPE_INPUT = 0x40
+TYPE_STATE_REQUEST = 0x41
+
+INPUT_JOYSTICK = 0
+INPUT_SELECT_DOWN = 1
+INPUT_SELECT_UP = 2
+INPUT_RESET_DOWN = 3
+
+SNAPSHOT_VALID = 0x01
+HOLDING = 0x02
+WON = 0x04
+
+STATE_FORMAT = '<HHIIHBBb36s'
+
+STEPS = {
+    'left': [(INPUT_JOYSTICK, -1, 0), (INPUT_JOYSTICK, 0, 0)],
+    'right': [(INPUT_JOYSTICK, 1, 0), (INPUT_JOYSTICK, 0, 0)],
+    'up': [(INPUT_JOYSTICK, 0, -1), (INPUT_JOYSTICK, 0, 0)],
+    'down': [(INPUT_JOYSTICK, 0, 1), (INPUT_JOYSTICK, 0, 0)],
+    'press': [(INPUT_SELECT_DOWN, 0, 0), (INPUT_SELECT_UP, 0, 0)],
+    'reset': [(INPUT_RESET_DOWN, 0, 0)],
+}
+
+
+def frame(kind, payload=b''):
+    body = bytes((kind, len(payload))) + payload
+    return bytes((SYNC,)) + body + bytes((crc8(body),))
+
+
+class Remote:
+    def __init__(self, path):
+        import serial
+        self.port = serial.Serial(path, BAUD, timeout=0.05)
+        self.buf = bytearray()
+
+    def send_input(self, kind, dx, dy):
+        self.port.write(frame(TYPE_INPUT, struct.pack('<Bbb', kind, dx, dy)))
+
+    def request_state(self):
+        self.port.write(frame(TYPE_STATE_REQUEST))
+
+    def next_state(self, timeout=None):
+        """The next TelemetryState frame as a dict, None on timeout."""
+        end = None if timeout is None else time.time() + timeout
+        while end is None or time.time() < end:
+            kind, payload = self._next_frame()
+            if kind == TYPE_STATE:
+                return decode_state(payload)
+            if kind is None:
+                self.buf += self.port.read(256)
+        return None
+
+    def _next_frame(self):
+        buf = self.buf
+        while True:
+            start = buf.find(SYNC)
+            if start < 0:
+                buf.clear()
+                return None, None
+            del buf[:start]
+            if len(buf) < 4 or len(buf) < 4 + buf[2]:
+                return None, None
+            length = buf[2]
+            body = bytes(buf[1:3 + length])
+            if crc8(body) == buf[3 + length]:
+                del buf[:4 + length]
+                return body[0], body[2:]
+            del buf[:1]
+
+
+def decode_state(payload):
+    (frame_n, hash_, latency, draw, area, flags, held, held_first,
+     snapshot) = struct.unpack(STATE_FORMAT, payload)
+    state = {'frame': frame_n, 'hash': hash_, 'latency_us': latency,
+             'draw_us': draw, 'area': area, 'flags': flags, 'held': held,
+             'held_first': held_first}
+    if flags & SNAPSHOT_VALID:
+        state['board'] = decode_snapshot(snapshot)
+    return state
+
+
+###############################################################################
+# the board
+
+def avr_rand(seed):
+    """avr-libc's rand() after srand(seed)."""
+    ctx = seed
+    while True:
+        x = ctx or 123459876
+        hi, lo = x // 127773, x % 127773
+        x = 16807 * lo - 2836 * hi
+        if x < 0:
+            x += 0x7FFFFFFF
+        ctx = x
+        yield x % 0x8000
+
+
+def deal(number):
+    """The shuffled deck of BoardState::initialize(number), as card hashes."""
+    rand = avr_rand(number)
+    for _ in range(16):  # the felt colours
+        next(rand)
+    deck = list(range(52))
+    for i in range(52):
+        j = i + next(rand) % (52 - i)
+        deck[i], deck[j] = deck[j], deck[i]
+    return deck
+
+
+class Bits:
+    def __init__(self, data):
+        self.data = data
+        self.bit = 0
+
+    def get(self, n):
+        value = 0
+        for i in range(n):
+            if self.data[self.bit >> 3] & (1 << (self.bit & 7)):
+                value |= 1 << i
+            self.bit += 1
+        return value
+
+
+def decode_snapshot(data):
+    """BoardState::snapshot() back into a board of card hashes."""
+    r = Bits(data)
+    board = {'deal': r.get(16), 'moves': r.get(16), 'score': r.get(16),
+             'seconds': r.get(16), 'cursor': (r.get(3), r.get(5))}
+    deck = deal(board['deal'])
+    board['foundations'] = []
+    for _ in range(4):
+        n, suit = r.get(4), r.get(2)
+        board['foundations'].append(suit * 13 + n - 1 if n else None)
+    board['columns'] = []
+    dealt = 0
+    for i in range(7):
+        down, up = r.get(3), r.get(4)
+        cards = [(h, False) for h in deck[dealt:dealt + down]]
+        dealt += i + 1
+        if up:
+            h = r.get(6)
+            cards.append((h, True))
+            for _ in range(up - 1):
+                suit = (1 - ((h // 13) & 1)) | (r.get(1) << 1)
+                h = suit * 13 + h % 13 - 1
+                cards.append((h, True))
+        board['columns'].append(cards)
+    stock = [deck[28 + k] for k in range(24) if r.get(1)]
+    top = r.get(5)
+    board['waste'] = stock[:top]
+    board['stock'] = stock[top:]
+    return board
+
+
+def card_name(h):
+    if h is None:
+        return '--'
+    return 'A23456789TJQK'[h % 13] + 'hsdc'[h // 13]
+
+
+def print_state(state):
+    print('frame %d  hash %04x  latency %.1f ms  draw %.1f ms  area %d' % (
+        state['frame'], state['hash'], state['latency_us'] / 1000.0,
+        state['draw_us'] / 1000.0, state['area']))
+    if state['flags'] & HOLDING:
+        print('holding %d from %s' % (state['held'], card_name(state['held_first'])))
+    board = state.get('board')
+    if not board:
+        return
+    print('deal %d  moves %d  score %d  %d:%02d  cursor %d,%d%s' % (
+        board['deal'], board['moves'], board['score'], board['seconds'] // 60,
+        board['seconds'] % 60, board['cursor'][0], board['cursor'][1],
+        '  won' if state['flags'] & WON else ''))
+    waste = ' '.join(card_name(h) for h in board['waste'][-3:])
+    print('[%2d] %-9s    %s' % (len(board['stock']), waste,
+          ' '.join(card_name(h) for h in board['foundations'])))
+    depth = max(len(c) for c in board['columns'])
+    for row in range(depth):
+        cells = []
+        for column in board['columns']:
+            if row >= len(column):
+                cells.append('  ')
+            elif column[row][1]:
+                cells.append(card_name(column[row][0]))
+            else:
+                cells.append('##')
+        print(' '.join(cells))
+    print()
+
+
+def main():
+    args = sys.argv[1:]
+    if len(args) < 2 or args[1] not in ('watch', 'state', 'send'):
+        sys.exit(__doc__)
+    remote = Remote(args[0])
+    command, steps = args[1], args[2:]
+    try:
+        if command == 'state':
+            remote.request_state()
+            state = remote.next_state(2)
+            if not state:
+                sys.exit('remote.py: no answer')
+            print_state(state)
+        elif command == 'watch':
+            remote.request_state()
+            while True:
+                print_state(remote.next_state())
+        else:
+            print('%-8s %5s %4s %10s %8s %6s' % ('step', 'frame', 'hash', 'latency_ms', 'draw_ms', 'area'))
+            for step in steps:
+                if step not in STEPS:
+                    sys.exit('remote.py: unknown step %s' % step)
+                for event in STEPS[step]:
+                    remote.send_input(*event)
+                state = remote.next_state(2)
+                if not state:
+                    sys.exit('remote.py: no frame for %s' % step)
+                print('%-8s %5d %04x %10.2f %8.2f %6d' % (
+                    step, state['frame'], state['hash'], state['latency_us'] / 1000.0,
+                    state['draw_us'] / 1000.0, state['area']))
+    except KeyboardInterrupt:
+        pass
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,1086 @@
+/*
+ * simbench - run the Solitaire firmware under simavr and report frame costs
+ *
+ * Build the firmware with SIM_BENCH defined (see the Makefile DEFINITIONS),
+ * then run:
+ *
+ *     simbench [-s script] [-o screen.ppm] [-H prefix] [-u uart.bin] [-L] [-p] [-m]
+ *              [-b budget_ms] [-c cycles] [-d div] [-P [-1 tty]]
+ *              [-r session.trace [-B baseline] [-w results]] Solitaire.elf
+ *
+ * The harness stands in for the hardware around the mega2560:
+ *   - a joystick on ADC0 / ADC1 and buttons on pins 9 / 14, driven by a script
+ *   - a virtual ST7735 on the SPI bus (CS pin 6, DC pin 7) that decodes
+ *     CASET / RASET / RAMWR into a 160x128 framebuffer
+ *
+ * The firmware writes BenchMarker values to GPIOR0, and every stage between a
+ * begin and end marker is reported with its CPU cycles, SPI traffic, SPI busy
+ * time and the on-target milliseconds those add up to.
+ *
+ * The display also counts how often each pixel is written within a stage.
+ * The report gives the worst pixel, the mean over the pixels touched, and the
+ * bytes spent on pixels that were written more than once. With -H every stage
+ * also gets a heatmap, <prefix>-<n>-<stage>.ppm, where untouched pixels show
+ * the screen dimmed and touched ones go blue, green, yellow, orange, red for
+ * 1 to 5+ writes.
+ *
+ * lat_ms is the time from the harness applying an input until the end of its
+ * frame, -b makes the run fail if any of them is over the budget. Serial
+ * output from the firmware goes to stderr, or to a file with -u, and -L asks
+ * a LATENCY_STATS build for its histogram at the end of the script (decode
+ * the capture with tools/telemetry.py). -p does the same for the profile of a
+ * PROFILE build, cleared once it has booted so it covers the script or the
+ * replay alone (tools/fwprofile.py Solitaire.elf uart.bin), and -m for
+ * the stack, heap and statics of an SRAM_STATS build (tools/sram.py).
+ *
+ * With -P there is no script. Once the firmware has booted the UART is
+ * connected to a new pty, printed on stdout as "pty <path>", and the firmware
+ * runs at the speed of the real board until the harness gets SIGINT or
+ * SIGTERM (and then writes -o). A REMOTE build can be driven through the pty
+ * with tools/remote.py in place of the board.
+ *
+ * -1 connects the second UART, Serial1, to a tty as well, for RACE builds.
+ * Two instances racing each other each get one end of a pty pair:
+ *     socat -d -d pty,raw,echo=0 pty,raw,echo=0   (prints the two ptys)
+ *     simbench -P -1 /dev/pts/<a> Solitaire.elf
+ *     simbench -P -1 /dev/pts/<b> Solitaire.elf
+ * and each is played through its own -P pty with tools/remote.py.
+ *
+ * -r replays a recorded session in place of the script, made from the log of
+ * an SD_LOG build with tools/eventlog.py -t. A trace is "deal <n>" and then
+ * one input per line at its time in milliseconds from the deal:
+ *     <ms> stick <dx> <dy>         the joystick moves to a direction, or 0 0
+ *     <ms> select down | up        the pin 9 button
+ *     <ms> reset <deal>            the pin 14 button, and the deal it gives
+ * The inputs are applied at the same times as they were recorded and the
+ * SPI bytes take as long as on the board (below), so the frames fall between
+ * the inputs as they did and the game sees the same play, stick repeats and
+ * all. The firmware is asked for the recorded deals through GPIOR2:GPIOR1. The report gives the latency of
+ * every input that starts an action (a push of the stick from rest, a select
+ * or a reset) as percentiles per kind, and the frames and SPI bytes of the
+ * whole session. -w writes those as "name value" lines, and -B compares the
+ * run with such a file and fails it if the bytes went up or a latency
+ * percentile got more than REPLAY_TOLERANCE worse. A session that started
+ * from a game resumed off the EEPROM won't replay the same.
+ *
+ * Script lines are one of (blank lines and # comments ignored), an optional
+ * label names the stage in the report:
+ *     left | right | up | down [label]   deflect the joystick for one move
+ *     press [label]                      press and release the pin 9 button
+ *     reset [label]                      press and release the pin 14 button
+ *     wait <ms>                          let the firmware idle
+ *
+ * simavr completes every SPI byte after a fixed delay rather than at the
+ * configured clock. The harness moves each byte's completion to the real
+ * 8 * divider cycles, with the divider the firmware set or the one given
+ * with -d, so sim_cycles and cycles agree. -c gives simavr's delay (1600 =
+ * 100us at 16MHz), which is how its timer is found. A simavr where it can't
+ * be found says so on stderr, and then only the reported times are
+ * corrected by the difference per byte: the firmware still runs with slow
+ * SPI, and a replay's inputs land later in the frames than they did.
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <termios.h>
+#include <time.h>
+
+#include "sim_avr.h"
+#include "sim_elf.h"
+#include "sim_core.h"
+#include "avr_spi.h"
+#include "avr_ioport.h"
+#include "avr_adc.h"
+#include "avr_uart.h"
+
+#define F_CPU          16000000UL
+#define SCREEN_W       160
+#define SCREEN_H       128
+#define GPIOR0_ADDR    0x3E  // data space address of GPIOR0
+#define GPIOR1_ADDR    0x4A
+#define GPIOR2_ADDR    0x4B
+
+#define JOY_CENTER_MV  2500
+#define JOY_DEFLECT_MV 1500
+
+// pin mapping of the mega2560 for the pins used by the firmware
+#define TFT_CS_PORT   'H'
+#define TFT_CS_BIT    3      // digital 6
+#define TFT_DC_PORT   'H'
+#define TFT_DC_BIT    4      // digital 7
+#define BUTTON1_PORT  'H'
+#define BUTTON1_BIT   6      // digital 9
+#define BUTTON2_PORT  'J'
+#define BUTTON2_BIT   1      // digital 14
+
+enum {
+	MarkBootBegin   = 1,
+	MarkBootEnd     = 2,
+	MarkActionBegin = 3,
+	MarkActionEnd   = 4,
+};
+
+static const char* defaultScript =
+	"# a short session over the stock, the waste and the tableau\n"
+	"right\n"
+	"right\n"
+	"left\n"
+	"left\n"
+	"left\n"
+	"press flip3\n"
+	"press flip3\n"
+	"right\n"
+	"down\n"
+	"down\n"
+	"right\n"
+	"right\n"
+	"press pickup\n"
+	"right held\n"
+	"right held\n"
+	"press putdown\n"
+	"reset newgame\n";
+
+
+///////////////////////////////////////////////////////////////////////////////
+// virtual display
+
+struct Counters {
+	unsigned long cmdBytes;
+	unsigned long dataBytes;
+	unsigned long csToggles;
+	unsigned long spiCycles; //the bus was busy with the display's bytes
+};
+
+struct Display {
+	int cs, dc;
+	uint8_t cmd;
+	int argN;
+	uint8_t args[4];
+	int xs, xe, ys, ye, x, y;
+	int writing;
+	uint8_t hi;
+	int haveHi;
+	uint16_t fb[SCREEN_W*SCREEN_H];
+	uint16_t writes[SCREEN_W*SCREEN_H]; //per pixel, reset at each stage
+	struct Counters count;
+};
+
+static struct Display display;
+
+static void display_pixel(struct Display* d, uint16_t color) {
+	if (d->x < SCREEN_W && d->y < SCREEN_H) {
+		d->fb[d->y*SCREEN_W + d->x] = color;
+		d->writes[d->y*SCREEN_W + d->x]++;
+	}
+	if (++d->x > d->xe) {
+		d->x = d->xs;
+		if (++d->y > d->ye)
+			d->y = d->ys;
+	}
+}
+
+static void display_byte(struct Display* d, uint8_t b) {
+	if (d->cs) return;
+	if (!d->dc) {
+		d->count.cmdBytes++;
+		d->cmd = b;
+		d->argN = 0;
+		d->haveHi = 0;
+		d->writing = (b == 0x2C); // RAMWR
+		if (d->writing) {
+			d->x = d->xs;
+			d->y = d->ys;
+		}
+		return;
+	}
+	d->count.dataBytes++;
+	if (d->writing) {
+		if (d->haveHi) {
+			display_pixel(d, (uint16_t)(d->hi << 8 | b));
+			d->haveHi = 0;
+		} else {
+			d->hi = b;
+			d->haveHi = 1;
+		}
+	} else if ((d->cmd == 0x2A || d->cmd == 0x2B) && d->argN < 4) {
+		d->args[d->argN++] = b;
+		if (d->argN == 4) {
+			int s = d->args[0] << 8 | d->args[1];
+			int e = d->args[2] << 8 | d->args[3];
+			if (d->cmd == 0x2A) { d->xs = s; d->xe = e; }
+			else                { d->ys = s; d->ye = e; }
+		}
+	}
+}
+
+static void spi_hook(struct avr_irq_t* irq, uint32_t value, void* param) {
+	display_byte(&display, (uint8_t)value);
+}
+static void cs_hook(struct avr_irq_t* irq, uint32_t value, void* param) {
+	if (display.cs && !value)
+		display.count.csToggles++;
+	display.cs = value ? 1 : 0;
+}
+static void dc_hook(struct avr_irq_t* irq, uint32_t value, void* param) {
+	display.dc = value ? 1 : 0;
+}
+
+static void rgb565_to_rgb(uint16_t c, uint8_t rgb[3]) {
+	rgb[0] = (uint8_t)((c >> 8) & 0xF8);
+	rgb[1] = (uint8_t)((c >> 3) & 0xFC);
+	rgb[2] = (uint8_t)((c << 3) & 0xF8);
+}
+
+static int write_ppm(const char* path, int heatmap) {
+	static const uint8_t ramp[5][3] = {
+		{  0,  64, 255},
+		{  0, 200,   0},
+		{255, 230,   0},
+		{255, 128,   0},
+		{255,   0,   0},
+	};
+	FILE* f = fopen(path, "wb");
+	if (!f) return -1;
+	fprintf(f, "P6\n%d %d\n255\n", SCREEN_W, SCREEN_H);
+	for (int i = 0; i < SCREEN_W*SCREEN_H; ++i) {
+		uint8_t rgb[3];
+		rgb565_to_rgb(display.fb[i], rgb);
+		if (heatmap) {
+			int n = display.writes[i];
+			if (n == 0) {
+				rgb[0] /= 4; rgb[1] /= 4; rgb[2] /= 4;
+			} else {
+				memcpy(rgb, ramp[n > 5 ? 4 : n-1], 3);
+			}
+		}
+		fwrite(rgb, 1, 3, f);
+	}
+	fclose(f);
+	return 0;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// SPI byte time
+
+// simavr completes every SPI byte a fixed 100us after SPDR is written, where
+// the board takes 8 * divider cycles. The first write finds simavr's timer
+// among the pending ones, and from then on every write moves it to the real
+// byte time at the divider the firmware has in SPCR / SPSR (the display and
+// the card run at different rates). The firmware's clock then keeps step
+// with the board's. If the timer isn't there the stage times are corrected
+// afterwards instead, by -c cycles per byte.
+#define SPCR_ADDR 0x4C
+#define SPSR_ADDR 0x4D
+#define SPDR_ADDR 0x4E
+
+enum { SpiUnknown, SpiRetimed, SpiCorrected };
+
+static unsigned long simSpiCycles = 1600;
+static unsigned spiDivider; // -d, 0 for the one the firmware set
+static int spiTiming;
+static avr_cycle_timer_t spiRaise;
+static void* spiRaiseParam;
+
+static unsigned long spi_byte_cycles(struct avr_t* a) {
+	static const unsigned dividers[4] = {4, 16, 64, 128};
+	if (spiDivider)
+		return 8*spiDivider;
+	unsigned d = dividers[a->data[SPCR_ADDR] & 3];
+	if (a->data[SPSR_ADDR] & 1) // SPI2X
+		d /= 2;
+	return 8*d;
+}
+
+// called after simavr's own SPDR write, which has just set its timer
+static void spdr_write(struct avr_t* a, avr_io_addr_t addr, uint8_t v, void* param) {
+	if (spiTiming == SpiUnknown) {
+		for (avr_cycle_timer_slot_p t = a->cycle_timers.timer; t; t = t->next) {
+			if (t->when == a->cycle + simSpiCycles) {
+				spiRaise = t->timer;
+				spiRaiseParam = t->param;
+				break;
+			}
+		}
+		spiTiming = spiRaise ? SpiRetimed : SpiCorrected;
+		if (!spiRaise)
+			fprintf(stderr, "simbench: no SPI timer %lu cycles out, correcting the times afterwards\n",
+				simSpiCycles);
+	}
+	if (spiTiming != SpiRetimed)
+		return;
+	unsigned long cycles = spi_byte_cycles(a);
+	avr_cycle_timer_cancel(a, spiRaise, spiRaiseParam);
+	avr_cycle_timer_register(a, cycles, spiRaise, spiRaiseParam);
+	if (!display.cs)
+		display.count.spiCycles += cycles;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// firmware side
+
+static avr_t* avr;
+static int lastMarker;
+static avr_cycle_count_t markerCycle;
+static int replaying;
+static void replay_marker(int marker);
+
+static void gpior0_write(struct avr_t* a, avr_io_addr_t addr, uint8_t v, void* param) {
+	a->data[addr] = v;
+	lastMarker = v;
+	markerCycle = a->cycle;
+	if (replaying)
+		replay_marker(v);
+}
+
+static FILE* uartOut;
+
+// a UART and the tty it is connected to, if any
+struct Link {
+	char uart;
+	int fd;
+	int xon;
+};
+static struct Link link0 = {'0', -1, 1}, link1 = {'1', -1, 1};
+
+static void uart_hook(struct avr_irq_t* irq, uint32_t value, void* param) {
+	struct Link* l = param;
+	uint8_t b = (uint8_t)value;
+	if (l->fd >= 0) {
+		//with nobody listening the byte is lost, as it would be on the wire
+		(void)!write(l->fd, &b, 1);
+	} else if (l == &link0) {
+		fputc(b, uartOut);
+	}
+}
+//simavr's receive fifo says when it has room
+static void uart_xon_hook(struct avr_irq_t* irq, uint32_t value, void* param) {
+	((struct Link*)param)->xon = 1;
+}
+static void uart_xoff_hook(struct avr_irq_t* irq, uint32_t value, void* param) {
+	((struct Link*)param)->xon = 0;
+}
+static void link_send(struct Link* l, uint8_t b) {
+	avr_raise_irq(avr_io_getirq(avr, AVR_IOCTL_UART_GETIRQ(l->uart), UART_IRQ_INPUT), b);
+}
+static void uart_send(uint8_t b) {
+	link_send(&link0, b);
+}
+// hand the firmware what has come in on the tty, as fast as it takes it
+static void link_poll(struct Link* l) {
+	uint8_t b;
+	while (l->fd >= 0 && l->xon && read(l->fd, &b, 1) == 1)
+		link_send(l, b);
+}
+static void link_hook_up(struct Link* l) {
+	uint32_t flags = 0;
+	avr_ioctl(avr, AVR_IOCTL_UART_GET_FLAGS(l->uart), &flags);
+	flags &= ~AVR_UART_FLAG_STDIO;
+	avr_ioctl(avr, AVR_IOCTL_UART_SET_FLAGS(l->uart), &flags);
+	avr_irq_register_notify(avr_io_getirq(avr, AVR_IOCTL_UART_GETIRQ(l->uart), UART_IRQ_OUTPUT), uart_hook, l);
+	avr_irq_register_notify(avr_io_getirq(avr, AVR_IOCTL_UART_GETIRQ(l->uart), UART_IRQ_OUT_XON), uart_xon_hook, l);
+	avr_irq_register_notify(avr_io_getirq(avr, AVR_IOCTL_UART_GETIRQ(l->uart), UART_IRQ_OUT_XOFF), uart_xoff_hook, l);
+}
+static void make_raw(int fd) {
+	struct termios tio;
+	tcgetattr(fd, &tio);
+	cfmakeraw(&tio);
+	tcsetattr(fd, TCSANOW, &tio);
+	fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+}
+
+static void set_adc(int channel, int mv) {
+	avr_raise_irq(avr_io_getirq(avr, AVR_IOCTL_ADC_GETIRQ, ADC_IRQ_ADC0 + channel), mv);
+}
+static void set_pin(char port, int bit, int level) {
+	avr_raise_irq(avr_io_getirq(avr, AVR_IOCTL_IOPORT_GETIRQ(port), bit), level);
+}
+
+static avr_cycle_count_t ms_to_cycles(unsigned ms) {
+	return (avr_cycle_count_t)ms * (F_CPU/1000);
+}
+
+// run until the given marker is written or the time limit passes
+static int run_until_marker(int marker, unsigned limitMs) {
+	avr_cycle_count_t end = avr->cycle + ms_to_cycles(limitMs);
+	lastMarker = 0;
+	while (lastMarker != marker && avr->cycle < end) {
+		int state = avr_run(avr);
+		if (state == cpu_Done || state == cpu_Crashed)
+			return -1;
+	}
+	return lastMarker == marker ? 0 : -1;
+}
+static void run_for(unsigned ms) {
+	avr_cycle_count_t end = avr->cycle + ms_to_cycles(ms);
+	while (avr->cycle < end) {
+		int state = avr_run(avr);
+		if (state == cpu_Done || state == cpu_Crashed)
+			return;
+	}
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// pty stand-in for the board
+
+static volatile sig_atomic_t stopping;
+
+static void on_stop(int sig) {
+	stopping = 1;
+}
+
+static double wall_ms(void) {
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec*1000.0 + t.tv_nsec/1000000.0;
+}
+
+static int run_pty(const char* link1Path) {
+	link0.fd = posix_openpt(O_RDWR | O_NOCTTY);
+	if (link0.fd < 0 || grantpt(link0.fd) != 0 || unlockpt(link0.fd) != 0) {
+		fprintf(stderr, "simbench: can't open a pty\n");
+		return -1;
+	}
+	make_raw(link0.fd);
+	if (link1Path) {
+		link1.fd = open(link1Path, O_RDWR | O_NOCTTY);
+		if (link1.fd < 0) {
+			fprintf(stderr, "simbench: can't open %s\n", link1Path);
+			return -1;
+		}
+		make_raw(link1.fd);
+	}
+	printf("pty %s\n", ptsname(link0.fd));
+	fflush(stdout);
+
+	signal(SIGINT, on_stop);
+	signal(SIGTERM, on_stop);
+	double startMs = wall_ms();
+	avr_cycle_count_t startCycle = avr->cycle;
+	while (!stopping) {
+		run_for(1);
+		link_poll(&link0);
+		link_poll(&link1);
+		//don't get ahead of the clock, the firmware's timeouts are real time
+		double aheadMs = (double)(avr->cycle - startCycle) / (F_CPU/1000) - (wall_ms() - startMs);
+		if (aheadMs > 1)
+			usleep((useconds_t)(aheadMs*1000));
+	}
+	close(link0.fd);
+	link0.fd = -1;
+	if (link1.fd >= 0) {
+		close(link1.fd);
+		link1.fd = -1;
+	}
+	return 0;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// reporting
+
+static const char* heatmapPrefix;
+static int stageN;
+static double budgetMs;
+static int overBudget;
+
+struct Stage {
+	avr_cycle_count_t cycles;
+	struct Counters count;
+};
+
+static void stage_begin(struct Stage* s) {
+	s->cycles = markerCycle;
+	s->count = display.count;
+	memset(display.writes, 0, sizeof(display.writes));
+}
+//the cycles the board would take, with simavr's SPI byte time swapped for
+//the real one when it couldn't be retimed as the firmware ran
+static double corrected_cycles(double cycles, unsigned long bytes) {
+	unsigned long byteCycles = 8*(spiDivider ? spiDivider : 4);
+	if (spiTiming == SpiCorrected && simSpiCycles > byteCycles)
+		cycles -= (double)bytes * (simSpiCycles - byteCycles);
+	return cycles < 0 ? 0 : cycles;
+}
+
+static void stage_end(struct Stage* s, const char* name, avr_cycle_count_t inputAt) {
+	unsigned long cycles = (unsigned long)(markerCycle - s->cycles);
+	unsigned long cmd  = display.count.cmdBytes  - s->count.cmdBytes;
+	unsigned long data = display.count.dataBytes - s->count.dataBytes;
+	unsigned long cs   = display.count.csToggles - s->count.csToggles;
+	unsigned long bytes = cmd + data;
+	double busyUs = spiTiming == SpiCorrected ?
+		bytes * 8.0*(spiDivider ? spiDivider : 4) / (F_CPU/1000000) :
+		(display.count.spiCycles - s->count.spiCycles) / (double)(F_CPU/1000000);
+	double target = corrected_cycles((double)cycles, bytes);
+	double latency = inputAt ?
+		corrected_cycles((double)(markerCycle - inputAt), bytes) / (F_CPU/1000) : 0;
+	if (budgetMs > 0 && latency > budgetMs)
+		overBudget++;
+
+	//overdraw
+	unsigned long touched = 0, writes = 0, maxWrites = 0;
+	for (int i = 0; i < SCREEN_W*SCREEN_H; ++i) {
+		unsigned n = display.writes[i];
+		if (!n) continue;
+		touched++;
+		writes += n;
+		if (n > maxWrites) maxWrites = n;
+	}
+	double mean = touched ? (double)writes / touched : 0;
+	unsigned long wasted = (writes - touched) * 2;
+
+	printf("%-10s %12lu %12.0f %8lu %8lu %6lu %10.0f %9.2f %5lu %6.2f %9lu %8.2f\n",
+		name, cycles, target, cmd, data, cs, busyUs, target / (F_CPU/1000),
+		maxWrites, mean, wasted, latency);
+
+	if (heatmapPrefix) {
+		char path[256];
+		snprintf(path, sizeof(path), "%s-%02d-%s.ppm", heatmapPrefix, stageN, name);
+		if (write_ppm(path, 1) != 0)
+			fprintf(stderr, "simbench: can't write %s\n", path);
+	}
+	stageN++;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// session replay
+
+#define REPLAY_TOLERANCE 0.02 // latency percentiles can be this much worse
+#define RESET_HOLD_MS    30   // the log only has the press of pin 14
+#define MAX_PENDING      64
+
+enum { ReplayMove, ReplaySelect, ReplayReset, ReplayKinds };
+static const char* replayKindNames[ReplayKinds + 1] = {"move", "select", "reset", "all"};
+
+enum { EventStick, EventSelectDown, EventSelectUp, EventResetDown, EventResetUp };
+
+struct ReplayEvent {
+	double atMs;
+	int type;
+	int a, b;  // direction, or the deal for a reset
+	int order; // in the file, to keep the sort stable
+};
+
+// inputs waiting for their frame, seen once the firmware has begun acting
+struct Pending {
+	avr_cycle_count_t cycle;
+	unsigned long bytes;
+	int kind;
+	int seen;
+};
+
+static struct Pending pending[MAX_PENDING];
+static int pendingN;
+static double* latencies[ReplayKinds];
+static int latencyN[ReplayKinds], latencyCap[ReplayKinds];
+static unsigned long replayFrames;
+static struct Counters replayStart; //the display's counts after boot
+
+static unsigned long display_bytes(void) {
+	return display.count.cmdBytes + display.count.dataBytes;
+}
+
+static void add_latency(int kind, double ms) {
+	if (latencyN[kind] == latencyCap[kind]) {
+		latencyCap[kind] = latencyCap[kind] ? latencyCap[kind]*2 : 256;
+		latencies[kind] = realloc(latencies[kind], latencyCap[kind]*sizeof(double));
+	}
+	latencies[kind][latencyN[kind]++] = ms;
+	if (budgetMs > 0 && ms > budgetMs)
+		overBudget++;
+}
+
+static void replay_marker(int marker) {
+	if (marker == MarkActionBegin) {
+		for (int i = 0; i < pendingN; ++i)
+			pending[i].seen = 1;
+	} else if (marker == MarkActionEnd) {
+		replayFrames++;
+		int kept = 0;
+		for (int i = 0; i < pendingN; ++i) {
+			struct Pending* p = &pending[i];
+			if (!p->seen) {
+				pending[kept++] = *p;
+				continue;
+			}
+			double cycles = corrected_cycles((double)(markerCycle - p->cycle), display_bytes() - p->bytes);
+			add_latency(p->kind, cycles / (F_CPU/1000));
+		}
+		pendingN = kept;
+	}
+}
+
+static void add_pending(int kind) {
+	if (pendingN == MAX_PENDING) return;
+	struct Pending* p = &pending[pendingN++];
+	p->cycle = avr->cycle;
+	p->bytes = display_bytes();
+	p->kind = kind;
+	p->seen = 0;
+}
+
+static int event_order(const void* a, const void* b) {
+	const struct ReplayEvent* x = a;
+	const struct ReplayEvent* y = b;
+	if (x->atMs != y->atMs)
+		return x->atMs < y->atMs ? -1 : 1;
+	return x->order - y->order;
+}
+
+static int cmp_double(const void* a, const void* b) {
+	double x = *(const double*)a, y = *(const double*)b;
+	return x < y ? -1 : x > y;
+}
+
+// the inputs of a trace, in time order, and the deal it starts with
+static int read_trace(const char* path, struct ReplayEvent** events, int* count, int* firstDeal) {
+	FILE* f = fopen(path, "r");
+	if (!f) {
+		fprintf(stderr, "simbench: can't open %s\n", path);
+		return -1;
+	}
+	int n = 0, cap = 256;
+	struct ReplayEvent* e = malloc(cap*sizeof(*e));
+	char line[128];
+	*firstDeal = 0;
+	while (fgets(line, sizeof(line), f)) {
+		char what[16], arg[16];
+		double at;
+		int b = 0;
+		if (sscanf(line, "%15s", what) != 1 || what[0] == '#')
+			continue;
+		if (!strcmp(what, "deal")) {
+			*firstDeal = atoi(line + 4);
+			continue;
+		}
+		if (n + 2 > cap) {
+			cap *= 2;
+			e = realloc(e, cap*sizeof(*e));
+		}
+		if (sscanf(line, "%lf %15s %15s %d", &at, what, arg, &b) < 3) {
+			fprintf(stderr, "simbench: bad trace line '%s'\n", line);
+			free(e);
+			fclose(f);
+			return -1;
+		}
+		e[n].atMs = at;
+		e[n].a = atoi(arg);
+		e[n].b = b;
+		e[n].order = n;
+		if (!strcmp(what, "stick")) {
+			e[n].type = EventStick;
+		} else if (!strcmp(what, "select")) {
+			e[n].type = strcmp(arg, "down") ? EventSelectUp : EventSelectDown;
+		} else if (!strcmp(what, "reset")) {
+			e[n].type = EventResetDown;
+			//and let go of it again
+			e[n+1] = e[n];
+			e[n+1].type = EventResetUp;
+			e[n+1].atMs += RESET_HOLD_MS;
+			e[n+1].order = n+1;
+			n++;
+		} else {
+			fprintf(stderr, "simbench: unknown trace input '%s'\n", what);
+			free(e);
+			fclose(f);
+			return -1;
+		}
+		n++;
+	}
+	fclose(f);
+	qsort(e, n, sizeof(*e), event_order);
+	*events = e;
+	*count = n;
+	return 0;
+}
+
+static void set_deal(int deal) {
+	avr->data[GPIOR1_ADDR] = deal & 0xFF;
+	avr->data[GPIOR2_ADDR] = (deal >> 8) & 0xFF;
+}
+
+static void replay(const struct ReplayEvent* events, int n) {
+	avr_cycle_count_t start = avr->cycle;
+	int dx = 0, dy = 0;
+	replayStart = display.count;
+	replaying = 1;
+	for (int i = 0; i < n; ++i) {
+		const struct ReplayEvent* e = &events[i];
+		avr_cycle_count_t at = start + (avr_cycle_count_t)(e->atMs * (F_CPU/1000));
+		while (avr->cycle < at) {
+			int state = avr_run(avr);
+			if (state == cpu_Done || state == cpu_Crashed)
+				return;
+		}
+		switch (e->type) {
+		case EventStick:
+			//only a push from rest makes the game act right away
+			if (!dx && !dy && (e->a || e->b))
+				add_pending(ReplayMove);
+			dx = e->a;
+			dy = e->b;
+			set_adc(1, JOY_CENTER_MV + dx*JOY_DEFLECT_MV);
+			set_adc(0, JOY_CENTER_MV - dy*JOY_DEFLECT_MV);
+			break;
+		case EventSelectDown:
+			add_pending(ReplaySelect);
+			set_pin(BUTTON1_PORT, BUTTON1_BIT, 0);
+			break;
+		case EventSelectUp:
+			set_pin(BUTTON1_PORT, BUTTON1_BIT, 1);
+			break;
+		case EventResetDown:
+			set_deal(e->a);
+			add_pending(ReplayReset);
+			set_pin(BUTTON2_PORT, BUTTON2_BIT, 0);
+			break;
+		case EventResetUp:
+			set_pin(BUTTON2_PORT, BUTTON2_BIT, 1);
+			break;
+		}
+	}
+	//let the last frames finish
+	run_for(1000);
+	replaying = 0;
+}
+
+struct Metric {
+	char name[32];
+	double value;
+	int traffic; // any increase is worse, not only one over the tolerance
+};
+
+static void add_metric(struct Metric* m, int* n, const char* name, double value, int traffic) {
+	snprintf(m[*n].name, sizeof(m[*n].name), "%s", name);
+	m[*n].value = value;
+	m[*n].traffic = traffic;
+	(*n)++;
+}
+
+// latency percentiles of each kind of input and of all of them, then the
+// totals of the session
+static int replay_metrics(struct Metric* m) {
+	static const int percentiles[] = {50, 90, 99, 100};
+	int total = 0;
+	for (int k = 0; k < ReplayKinds; ++k)
+		total += latencyN[k];
+	double* all = malloc((total + 1)*sizeof(double));
+	int n = 0;
+	for (int k = 0; k <= ReplayKinds; ++k) {
+		int count = 0;
+		for (int j = 0; j < ReplayKinds; ++j) {
+			if (j != k && k != ReplayKinds) continue;
+			memcpy(all + count, latencies[j], latencyN[j]*sizeof(double));
+			count += latencyN[j];
+		}
+		qsort(all, count, sizeof(double), cmp_double);
+		for (int p = 0; p < 4; ++p) {
+			char name[32];
+			if (percentiles[p] == 100)
+				snprintf(name, sizeof(name), "%s_max_ms", replayKindNames[k]);
+			else
+				snprintf(name, sizeof(name), "%s_p%d_ms", replayKindNames[k], percentiles[p]);
+			add_metric(m, &n, name, count ? all[(int)(percentiles[p]/100.0*(count-1) + 0.5)] : 0, 0);
+		}
+	}
+	free(all);
+	add_metric(m, &n, "frames", replayFrames, 0);
+	add_metric(m, &n, "cmd_bytes", display.count.cmdBytes - replayStart.cmdBytes, 1);
+	add_metric(m, &n, "data_bytes", display.count.dataBytes - replayStart.dataBytes, 1);
+	add_metric(m, &n, "cs_toggles", display.count.csToggles - replayStart.csToggles, 1);
+	return n;
+}
+
+static int replay_report(const char* tracePath, double sessionMs, const char* baselinePath, const char* writePath) {
+	struct Metric m[32];
+	int n = replay_metrics(m);
+	int status = 0;
+
+	printf("\nreplay of %s: %.1f s, %.0f frames, %.0f cmd_B, %.0f data_B, %.0f cs, %d inputs without a frame\n",
+		tracePath, sessionMs / 1000, m[n-4].value, m[n-3].value, m[n-2].value, m[n-1].value, pendingN);
+	printf("%-8s %6s %8s %8s %8s %8s   (lat_ms)\n", "input", "count", "p50", "p90", "p99", "max");
+	int total = 0;
+	for (int k = 0; k <= ReplayKinds; ++k) {
+		int count = k < ReplayKinds ? latencyN[k] : total;
+		total += count;
+		printf("%-8s %6d %8.2f %8.2f %8.2f %8.2f\n", replayKindNames[k], count,
+			m[k*4].value, m[k*4+1].value, m[k*4+2].value, m[k*4+3].value);
+	}
+
+	if (writePath) {
+		FILE* f = fopen(writePath, "w");
+		if (!f) {
+			fprintf(stderr, "simbench: can't write %s\n", writePath);
+			return 1;
+		}
+		for (int i = 0; i < n; ++i)
+			fprintf(f, "%s %.3f\n", m[i].name, m[i].value);
+		fclose(f);
+	}
+
+	if (baselinePath) {
+		FILE* f = fopen(baselinePath, "r");
+		if (!f) {
+			fprintf(stderr, "simbench: can't open %s\n", baselinePath);
+			return 1;
+		}
+		printf("\n%-16s %12s %12s %8s\n", "vs baseline", "before", "after", "change");
+		char name[32];
+		double before;
+		while (fscanf(f, "%31s %lf", name, &before) == 2) {
+			for (int i = 0; i < n; ++i) {
+				if (strcmp(name, m[i].name)) continue;
+				double after = m[i].value;
+				//frames only depend on the play, they are there to spot a broken replay
+				int worse = m[i].traffic ? after > before :
+					strstr(name, "_ms") && after > before*(1 + REPLAY_TOLERANCE) + 0.01;
+				printf("%-16s %12.2f %12.2f %+7.1f%%%s\n", name, before, after,
+					before ? (after - before)*100 / before : 0.0, worse ? "  worse" : "");
+				status |= worse;
+			}
+		}
+		fclose(f);
+	}
+	return status;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+
+static int do_step(const char* line) {
+	char name[32];
+	char label[32] = "";
+	if (sscanf(line, "%31s %31s", name, label) < 1 || name[0] == '#')
+		return 0;
+
+	if (!strcmp(name, "wait")) {
+		run_for((unsigned)atoi(label));
+		return 0;
+	}
+
+	struct Stage s;
+	avr_cycle_count_t inputAt = avr->cycle;
+	if (!strcmp(name, "left"))       set_adc(1, JOY_CENTER_MV - JOY_DEFLECT_MV);
+	else if (!strcmp(name, "right")) set_adc(1, JOY_CENTER_MV + JOY_DEFLECT_MV);
+	else if (!strcmp(name, "up"))    set_adc(0, JOY_CENTER_MV + JOY_DEFLECT_MV);
+	else if (!strcmp(name, "down"))  set_adc(0, JOY_CENTER_MV - JOY_DEFLECT_MV);
+	else if (!strcmp(name, "press")) set_pin(BUTTON1_PORT, BUTTON1_BIT, 0);
+	else if (!strcmp(name, "reset")) set_pin(BUTTON2_PORT, BUTTON2_BIT, 0);
+	else {
+		fprintf(stderr, "simbench: unknown step '%s'\n", name);
+		return -1;
+	}
+
+	//release everything once the firmware has acted on it, well inside the
+	//300ms (InitialDelayMs) before a held stick repeats, so each step is one move
+	int ok = run_until_marker(MarkActionBegin, 2000);
+	set_adc(0, JOY_CENTER_MV);
+	set_adc(1, JOY_CENTER_MV);
+	set_pin(BUTTON1_PORT, BUTTON1_BIT, 1);
+	set_pin(BUTTON2_PORT, BUTTON2_BIT, 1);
+	if (ok == 0) {
+		stage_begin(&s);
+		ok = run_until_marker(MarkActionEnd, 5000);
+	}
+	if (ok != 0) {
+		fprintf(stderr, "simbench: no frame for step '%s'\n", name);
+		return -1;
+	}
+	stage_end(&s, label[0] ? label : name, inputAt);
+	run_for(50);
+	return 0;
+}
+
+static int run_script(const char* path) {
+	FILE* script = NULL;
+	if (path) {
+		script = fopen(path, "r");
+		if (!script) {
+			fprintf(stderr, "simbench: can't open %s\n", path);
+			return -1;
+		}
+	} else {
+		script = fmemopen((void*)defaultScript, strlen(defaultScript), "r");
+	}
+	char line[128];
+	int status = 0;
+	while (fgets(line, sizeof(line), script)) {
+		if (do_step(line) != 0) {
+			status = -1;
+			break;
+		}
+	}
+	fclose(script);
+	return status;
+}
+
+static void usage(void) {
+	fprintf(stderr,
+		"usage: simbench [-s script] [-o screen.ppm] [-H heatmap_prefix] [-u uart.bin] [-L] [-p] [-m]\n"
+		"                [-b budget_ms] [-c sim_spi_cycles] [-d spi_divider] [-P [-1 tty]]\n"
+		"                [-r session.trace [-B baseline] [-w results]] firmware.elf\n");
+	exit(2);
+}
+
+int main(int argc, char** argv) {
+	const char* scriptPath = NULL;
+	const char* ppmPath = NULL;
+	const char* uartPath = NULL;
+	int dumpLatency = 0;
+	int dumpProfile = 0;
+	int dumpSram = 0;
+	int pty = 0;
+	const char* link1Path = NULL;
+	const char* tracePath = NULL;
+	const char* baselinePath = NULL;
+	const char* writePath = NULL;
+	int opt;
+	while ((opt = getopt(argc, argv, "s:o:H:u:Lpmb:c:d:P1:r:B:w:")) != -1) {
+		switch (opt) {
+		case 's': scriptPath = optarg; break;
+		case 'o': ppmPath = optarg; break;
+		case 'H': heatmapPrefix = optarg; break;
+		case 'u': uartPath = optarg; break;
+		case 'L': dumpLatency = 1; break;
+		case 'p': dumpProfile = 1; break;
+		case 'm': dumpSram = 1; break;
+		case 'b': budgetMs = atof(optarg); break;
+		case 'c': simSpiCycles = strtoul(optarg, NULL, 0); break;
+		case 'd': spiDivider = (unsigned)strtoul(optarg, NULL, 0); break;
+		case 'P': pty = 1; break;
+		case '1': link1Path = optarg; break;
+		case 'r': tracePath = optarg; break;
+		case 'B': baselinePath = optarg; break;
+		case 'w': writePath = optarg; break;
+		default: usage();
+		}
+	}
+	if (optind != argc-1 || (link1Path && !pty)) usage();
+
+	elf_firmware_t fw;
+	memset(&fw, 0, sizeof(fw));
+	if (elf_read_firmware(argv[optind], &fw) != 0) {
+		fprintf(stderr, "simbench: can't load %s\n", argv[optind]);
+		return 1;
+	}
+	avr = avr_make_mcu_by_name("atmega2560");
+	if (!avr) {
+		fprintf(stderr, "simbench: simavr has no atmega2560 core\n");
+		return 1;
+	}
+	avr_init(avr);
+	avr_load_firmware(avr, &fw);
+	avr->frequency = F_CPU;
+	avr->vcc = avr->avcc = avr->aref = 5000;
+
+	//hook up the display and the marker register
+	memset(&display, 0, sizeof(display));
+	display.cs = 1;
+	avr_irq_register_notify(avr_io_getirq(avr, AVR_IOCTL_SPI_GETIRQ(0), SPI_IRQ_OUTPUT), spi_hook, NULL);
+	avr_irq_register_notify(avr_io_getirq(avr, AVR_IOCTL_IOPORT_GETIRQ(TFT_CS_PORT), TFT_CS_BIT), cs_hook, NULL);
+	avr_irq_register_notify(avr_io_getirq(avr, AVR_IOCTL_IOPORT_GETIRQ(TFT_DC_PORT), TFT_DC_BIT), dc_hook, NULL);
+	avr_register_io_write(avr, GPIOR0_ADDR, gpior0_write, NULL);
+	avr_register_io_write(avr, SPDR_ADDR, spdr_write, NULL);
+
+	//firmware Serial output goes to stderr, or a capture file
+	uartOut = stderr;
+	if (uartPath && !(uartOut = fopen(uartPath, "wb"))) {
+		fprintf(stderr, "simbench: can't write %s\n", uartPath);
+		return 1;
+	}
+	link_hook_up(&link0);
+	link_hook_up(&link1);
+
+	//idle inputs: joystick centered, buttons released (pulled up)
+	set_adc(0, JOY_CENTER_MV);
+	set_adc(1, JOY_CENTER_MV);
+	set_adc(7, 1234);
+	set_pin(BUTTON1_PORT, BUTTON1_BIT, 1);
+	set_pin(BUTTON2_PORT, BUTTON2_BIT, 1);
+
+	//a replay asks for the deal the session started with
+	struct ReplayEvent* events = NULL;
+	int eventN = 0;
+	if (tracePath) {
+		int deal;
+		if (read_trace(tracePath, &events, &eventN, &deal) != 0)
+			return 1;
+		if (deal <= 0) {
+			fprintf(stderr, "simbench: %s doesn't start with a deal\n", tracePath);
+			return 1;
+		}
+		set_deal(deal);
+	}
+
+	printf("%-10s %12s %12s %8s %8s %6s %10s %9s %5s %6s %9s %8s\n",
+		"stage", "sim_cycles", "cycles", "cmd_B", "data_B", "cs", "spi_us", "ms",
+		"max", "mean", "wasted_B", "lat_ms");
+
+	struct Stage boot;
+	if (run_until_marker(MarkBootBegin, 10000) != 0) {
+		fprintf(stderr, "simbench: firmware never reached initialize(), built with SIM_BENCH?\n");
+		return 1;
+	}
+	stage_begin(&boot);
+	if (run_until_marker(MarkBootEnd, 20000) != 0) {
+		fprintf(stderr, "simbench: no first frame\n");
+		return 1;
+	}
+	stage_end(&boot, "boot", 0);
+
+	int status = 0;
+	if (dumpProfile)
+		uart_send('p');
+	if (pty) {
+		if (run_pty(link1Path) != 0)
+			return 1;
+		if (ppmPath && write_ppm(ppmPath, 0) != 0) {
+			fprintf(stderr, "simbench: can't write %s\n", ppmPath);
+			status = 1;
+		}
+		return status;
+	}
+
+	if (tracePath) {
+		replay(events, eventN);
+		double sessionMs = eventN ? events[eventN-1].atMs : 0;
+		status |= replay_report(tracePath, sessionMs, baselinePath, writePath);
+		free(events);
+	} else if (run_script(scriptPath) != 0) {
+		status = 1;
+	}
+
+	if (dumpLatency) {
+		uart_send('L');
+		run_for(100);
+	}
+	if (dumpProfile) {
+		uart_send('P');
+		run_for(100);
+	}
+	if (dumpSram) {
+		uart_send('M');
+		run_for(100);
+	}
+	if (uartOut != stderr)
+		fclose(uartOut);
+	if (overBudget) {
+		fprintf(stderr, "simbench: %d stages over the %.1f ms budget\n", overBudget, budgetMs);
+		status = 1;
+	}
+
+	if (ppmPath && write_ppm(ppmPath, 0) != 0) {
+		fprintf(stderr, "simbench: can't write %s\n", ppmPath);
+		status = 1;
+	}
+	return status;
+}
@@ -0,0 +1,43 @@
+#!/usr/bin/env python3
+"""Compare two SPI_BENCH result files.
+
+Build the firmware with SPI_STATS and SPI_BENCH, capture what it prints over
+Serial (or what simbench prints to stderr) into a file per commit, then:
+
+    tools/spicompare.py before.json after.json
+
+Prints the per-benchmark change in bytes on the bus and estimated time, and
+exits with status 1 if anything got more expensive.
+"""
+import json
+import sys
+
+
+def load(path):
+    with open(path) as f:
+        text = f.read()
+    # tolerate boot noise around the document
+    doc = json.loads(text[text.index('{'):text.rindex('}') + 1])
+    return {r['name']: r for r in doc['results']}
+
+
+def main():
+    if len(sys.argv) != 3:
+        sys.exit(__doc__)
+    before, after = load(sys.argv[1]), load(sys.argv[2])
+    worse = False
+    print('%-20s %10s %10s %8s %10s' % ('name', 'bytes', 'after', 'delta', 'est_us'))
+    for name in sorted(set(before) | set(after)):
+        a, b = before.get(name), after.get(name)
+        if a is None or b is None:
+            print('%-20s %s' % (name, 'added' if a is None else 'removed'))
+            continue
+        ab = a['command_bytes'] + a['data_bytes']
+        bb = b['command_bytes'] + b['data_bytes']
+        worse |= bb > ab
+        print('%-20s %10d %10d %+8d %+10d' % (name, ab, bb, bb - ab, b['est_us'] - a['est_us']))
+    sys.exit(1 if worse else 0)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,103 @@
+#!/usr/bin/env python3
+"""Print how the firmware uses the mega2560's 8KB of SRAM.
+
+    tools/sram.py Solitaire.elf                 # the statics alone
+    tools/sram.py Solitaire.elf /dev/ttyACM0    # and the heap and stack, live
+    tools/sram.py Solitaire.elf uart.bin        # captured by simbench -m -u
+
+The statics come from the ELF's .data and .bss symbols, read with avr-nm (-n
+picks another nm), totalled per source file when the build has line info and
+per symbol when it doesn't. String literals and other data without a symbol
+are the difference to the section sizes. An SRAM_STATS build adds the heap,
+its free list and the deepest the stack has been since boot (Sram.h).
+"""
+import os
+import struct
+import subprocess
+import sys
+
+from telemetry import frames, open_stream
+
+TYPE_SRAM = 5
+
+SRAM_DUMP_REQUEST = b'M'
+SRAM_FORMAT = '<HHHHHHBHHH'
+
+
+def statics(elf, nm):
+    """(size, name, file) of every symbol in .data and .bss."""
+    out = subprocess.run([nm, '-C', '-S', '-l', '--defined-only', elf],
+                         check=True, capture_output=True, text=True).stdout
+    syms = []
+    for line in out.splitlines():
+        parts = line.split(None, 3)
+        if len(parts) < 4 or parts[2] not in 'dDbBvV':
+            continue
+        name, _, where = parts[3].partition('\t')
+        source = os.path.basename(where.rsplit(':', 1)[0]) if where else None
+        syms.append((int(parts[1], 16), name, source))
+    return syms
+
+
+def read_report(stream):
+    for kind, payload in frames(stream):
+        if kind == TYPE_SRAM:
+            return dict(zip(('ram', 'data', 'bss', 'heap', 'heap_free',
+                             'heap_largest', 'heap_blocks', 'stack_now',
+                             'stack_max', 'untouched'),
+                            struct.unpack(SRAM_FORMAT, payload)))
+    return None
+
+
+def print_statics(syms):
+    groups = {}
+    for size, name, source in syms:
+        key = source or name
+        groups[key] = groups.get(key, 0) + size
+    total = sum(groups.values())
+    print('%6s  %s' % ('bytes', 'statics'))
+    for key, size in sorted(groups.items(), key=lambda kv: -kv[1]):
+        if size >= 8:
+            print('%6d  %s' % (size, key))
+    print('%6d  in symbols' % total)
+    return total
+
+
+def print_report(r, in_symbols):
+    used = r['data'] + r['bss'] + r['heap'] + r['stack_max']
+    print()
+    print('%6d  ram' % r['ram'])
+    print('%6d  .data, with %d bytes of statics without a symbol' % (
+        r['data'], max(0, r['data'] + r['bss'] - in_symbols)))
+    print('%6d  .bss' % r['bss'])
+    print('%6d  heap, %d free in %d blocks, the largest %d (%.0f%% fragmented)' % (
+        r['heap'], r['heap_free'], r['heap_blocks'], r['heap_largest'],
+        100.0 * (1 - r['heap_largest'] / r['heap_free']) if r['heap_free'] else 0))
+    print('%6d  stack at its deepest, %d now' % (r['stack_max'], r['stack_now']))
+    print('%6d  never touched, %.0f%% of the ram' % (
+        r['untouched'], 100.0 * r['untouched'] / r['ram']))
+    if used + r['untouched'] != r['ram']:
+        print('        (%d bytes unaccounted for)' % (r['ram'] - used - r['untouched']))
+
+
+def main():
+    args = sys.argv[1:]
+    nm = 'avr-nm'
+    if len(args) > 1 and args[0] == '-n':
+        nm, args = args[1], args[2:]
+    if len(args) not in (1, 2):
+        sys.exit(__doc__)
+    in_symbols = print_statics(statics(args[0], nm))
+    if len(args) == 1:
+        return
+    stream = open_stream(args[1])
+    if args[1].startswith('/dev/'):
+        stream.write(SRAM_DUMP_REQUEST)
+    report = read_report(stream)
+    if not report:
+        sys.exit('sram.py: no report in %s, is it an SRAM_STATS build?' % args[1])
+    print_report(report, in_symbols)
+
+
+if __name__ == '__main__':
+    main()
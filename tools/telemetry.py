@@ -0,0 +1,157 @@
+#!/usr/bin/env python3
+"""Decode the binary telemetry the firmware streams over Serial.
+
+    tools/telemetry.py /dev/ttyACM0          # live, needs pyserial
+    tools/telemetry.py capture.bin           # a saved capture
+    tools/telemetry.py -l /dev/ttyACM0       # ask for the latency histogram
+
+Frames are described in Telemetry.h. Stage timings (FRAME_TIMING builds) are
+collected until the stream ends or ^C, then printed as percentiles per stage.
+Latency histograms (LATENCY_STATS builds) are printed as they arrive.
+"""
+import struct
+import sys
+
+SYNC = 0xA5
+BAUD = 500000
+
+TYPE_FRAME_TIMING = 1
+TYPE_LATENCY = 2
+
+LATENCY_DUMP_REQUEST = b'L'
+LATENCY_MIN_SHIFT = 8
+LATENCY_BUCKETS = 32
+
+STAGES = ['input', 'action', 'background', 'deck', 'waste',
+          'foundations', 'tableau', 'held', 'cursor',
+          'hud']
+
+
+def crc8(data):
+    """Dallas/iButton CRC-8, as avr-libc's _crc_ibutton_update."""
+    crc = 0
+    for b in data:
+        crc ^= b
+        for _ in range(8):
+            crc = (crc >> 1) ^ 0x8C if crc & 1 else crc >> 1
+    return crc
+
+
+def frames(stream):
+    """Yield (type, payload) for every frame with a good CRC."""
+    buf = bytearray()
+    while True:
+        chunk = stream.read(256)
+        if not chunk:
+            return
+        buf += chunk
+        while True:
+            start = buf.find(SYNC)
+            if start < 0:
+                buf.clear()
+                break
+            del buf[:start]
+            if len(buf) < 4 or len(buf) < 4 + buf[2]:
+                break
+            length = buf[2]
+            body = bytes(buf[1:3 + length])
+            if crc8(body) == buf[3 + length]:
+                yield body[0], body[2:]
+                del buf[:4 + length]
+            else:
+                del buf[:1]  # false sync, resync on the next one
+
+
+def open_stream(path):
+    if path.startswith('/dev/'):
+        import serial
+        return serial.Serial(path, BAUD, timeout=1)
+    return open(path, 'rb')
+
+
+def percentile(values, p):
+    values = sorted(values)
+    return values[min(len(values) - 1, int(round(p / 100.0 * (len(values) - 1))))]
+
+
+class FrameTimings:
+    FORMAT = '<HH%dH' % len(STAGES)
+
+    def __init__(self):
+        self.stages = {name: [] for name in STAGES + ['total']}
+        self.areas = []
+        self.frames = 0
+        self.lost = 0
+        self.last = None
+
+    def add(self, payload):
+        fields = struct.unpack(self.FORMAT, payload)
+        frame, area, ticks = fields[0], fields[1], fields[2:]
+        if self.last is not None:
+            self.lost += (frame - self.last - 1) & 0xFFFF
+        self.last = frame
+        self.frames += 1
+        self.areas.append(area)
+        for name, t in zip(STAGES, ticks):
+            self.stages[name].append(t * 4)
+        self.stages['total'].append(sum(ticks) * 4)
+
+    def report(self):
+        print('%d frames, %d lost' % (self.frames, self.lost))
+        if not self.frames:
+            return
+        print('%-12s %8s %8s %8s %8s   (us)' % ('stage', 'p50', 'p90', 'p99', 'max'))
+        for name, values in self.stages.items():
+            print('%-12s %8d %8d %8d %8d' % (name, percentile(values, 50),
+                  percentile(values, 90), percentile(values, 99), max(values)))
+        print('%-12s %8d %8d %8d %8d   (pixels)' % ('dirty area',
+              percentile(self.areas, 50), percentile(self.areas, 90),
+              percentile(self.areas, 99), max(self.areas)))
+
+
+def bucket_floor(i):
+    """Lowest latency in us that lands in bucket i."""
+    if i == 0:
+        return 0
+    octave = LATENCY_MIN_SHIFT + (i - 1) // 2
+    return (1 << octave) + ((i - 1) & 1) * (1 << (octave - 1))
+
+
+def print_latency(payload):
+    fields = struct.unpack('<IHHI%dH' % LATENCY_BUCKETS, payload)
+    budget, count, over, worst, buckets = fields[0], fields[1], fields[2], fields[3], fields[4:]
+    print('%d events, %d over the %.1f ms budget, worst %.1f ms' %
+          (count, over, budget / 1000.0, worst / 1000.0))
+    peak = max(buckets) or 1
+    for i, n in enumerate(buckets):
+        if n:
+            print('  >= %9.2f ms %6d %s' % (bucket_floor(i) / 1000.0, n, '#' * (40 * n // peak)))
+
+
+def main():
+    args = sys.argv[1:]
+    ask_latency = '-l' in args
+    if ask_latency:
+        args.remove('-l')
+    if len(args) != 1:
+        sys.exit(__doc__)
+    stream = open_stream(args[0])
+    if ask_latency:
+        stream.write(LATENCY_DUMP_REQUEST)
+    timings = FrameTimings()
+    try:
+        for kind, payload in frames(stream):
+            if kind == TYPE_FRAME_TIMING:
+                timings.add(payload)
+            elif kind == TYPE_LATENCY:
+                print_latency(payload)
+                if ask_latency:
+                    break
+    except KeyboardInterrupt:
+        pass
+    if timings.frames:
+        timings.report()
+
+
+if __name__ == '__main__':
+    main()